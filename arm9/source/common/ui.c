@@ -41,6 +41,20 @@ static u8* font_bin = NULL;
 static u16* font_map = NULL;
 static u16 ascii_lut[0x60];
 
+// expanded glyphs for a given color / bgcolor, pixels stored in framebuffer column order
+#define GLYPH_CACHE_SIZE    256
+#define GLYPH_CACHE_PIXELS  (8 * 16) // max font_width * font_height for cached glyphs
+
+typedef struct {
+    u32 color;
+    u32 bgcolor;
+    u16 index;
+    bool valid;
+    u16 pixels[GLYPH_CACHE_PIXELS];
+} GlyphCacheEntry;
+
+static GlyphCacheEntry* glyph_cache = NULL;
+
 // lookup table to sort CP-437 so it can be binary searched with Unicode codepoints
 static const u8 cp437_sorted[0x100] = {
     0x00, 0xF5, 0xF6, 0xFC, 0xFD, 0xFB, 0xFA, 0xA4, 0xF3, 0xF2, 0xF4, 0xF9, 0xF8, 0xFE, 0xFF, 0xF7,
@@ -334,6 +348,11 @@ bool SetFont(const void* font, u32 font_size) {
     }
 
     line_height = min(10, font_height + 2);
+
+    // expanded glyphs are invalid now
+    if (glyph_cache) free(glyph_cache);
+    glyph_cache = NULL;
+
     return true;
 }
 
@@ -426,14 +445,52 @@ void DrawQrCode(u16 *screen, const u8* qrcode)
     }
 }
 
-void DrawCharacter(u16 *screen, u32 character, int x, int y, u32 color, u32 bgcolor)
+static const u16* GetGlyphPixels(u16 index, u32 color, u32 bgcolor)
 {
+    if ((bgcolor == COLOR_TRANSPARENT) || (font_width * font_height > GLYPH_CACHE_PIXELS))
+        return NULL;
+    if (!glyph_cache) glyph_cache = (GlyphCacheEntry*) calloc(GLYPH_CACHE_SIZE, sizeof(GlyphCacheEntry));
+    if (!glyph_cache) return NULL;
+
+    GlyphCacheEntry* entry = &(glyph_cache[(index ^ color ^ (bgcolor >> 5)) % GLYPH_CACHE_SIZE]);
+    if (!entry->valid || (entry->index != index) || (entry->color != color) || (entry->bgcolor != bgcolor)) {
+        const u8* glyph = font_bin + (index * font_height);
+        u16* pixels = entry->pixels;
+        for (u32 xx = 0; xx < font_width; xx++) {
+            u8 mask = 0x80 >> xx;
+            for (int yy = font_height - 1; yy >= 0; yy--)
+                *(pixels++) = (glyph[yy] & mask) ? color : bgcolor;
+        }
+        entry->color = color;
+        entry->bgcolor = bgcolor;
+        entry->index = index;
+        entry->valid = true;
+    }
+
+    return entry->pixels;
+}
+
+static void DrawGlyph(u16 *screen, u16 index, int x, int y, u32 color, u32 bgcolor)
+{
+    // opaque background: copy the expanded glyph, one column at a time
+    const u16* pixels = GetGlyphPixels(index, color, bgcolor);
+    if (pixels) {
+        u16* screenPos = screen + PIXEL_OFFSET(x, y + (int) font_height - 1);
+        for (u32 xx = 0; xx < font_width; xx++) {
+            memcpy(screenPos, pixels, font_height * sizeof(u16));
+            screenPos += SCREEN_HEIGHT;
+            pixels += font_height;
+        }
+        return;
+    }
+
+    const u8* glyph = font_bin + (index * font_height);
     for (int yy = 0; yy < (int) font_height; yy++) {
         int xDisplacement = x * SCREEN_HEIGHT;
         int yDisplacement = SCREEN_HEIGHT - (y + yy) - 1;
         u16* screenPos = screen + xDisplacement + yDisplacement;
 
-        u8 charPos = font_bin[GetFontIndex(character, true) * font_height + yy];
+        u8 charPos = glyph[yy];
         for (int xx = 7; xx >= (8 - (int) font_width); xx--) {
             if ((charPos >> xx) & 1) {
                 *screenPos = color;
@@ -445,12 +502,17 @@ void DrawCharacter(u16 *screen, u32 character, int x, int y, u32 color, u32 bgco
     }
 }
 
+void DrawCharacter(u16 *screen, u32 character, int x, int y, u32 color, u32 bgcolor)
+{
+    DrawGlyph(screen, GetFontIndex(character, true), x, y, color, bgcolor);
+}
+
 void DrawString(u16 *screen, const char *str, int x, int y, u32 color, u32 bgcolor)
 {
     size_t max_len = (((screen == TOP_SCREEN) ? SCREEN_WIDTH_TOP : SCREEN_WIDTH_BOT) - x) / font_width;
 
     for (size_t i = 0; i < max_len && *str; i++) {
-        DrawCharacter(screen, GetCharacter(&str), x + i * font_width, y, color, bgcolor);
+        DrawGlyph(screen, GetFontIndex(GetCharacter(&str), true), x + i * font_width, y, color, bgcolor);
     }
 }
 
@@ -1,10 +1,14 @@
 /* original version by megazig */
 #include "aes.h"
+#include <string.h>
 
+#ifndef SOFT_CRYPTO // see aessoft.c for the software engine
 // FIXME some things make assumptions about alignemnts!
 // setup_aeskey? and set_ctr do not anymore (c) d0k3
 void setup_aeskeyX(uint8_t keyslot, const void* keyx)
 {
+    if (!aeskeycache_store(keyslot, 'X', keyx)) return;
+
     uint32_t _keyx[4] __attribute__((aligned(32)));
     for (uint32_t i = 0; i < 16u; i++)
         ((uint8_t*)_keyx)[i] = ((uint8_t*)keyx)[i];
@@ -28,6 +32,8 @@ void setup_aeskeyX(uint8_t keyslot, const void* keyx)
 
 void setup_aeskeyY(uint8_t keyslot, const void* keyy)
 {
+    if (!aeskeycache_store(keyslot, 'Y', keyy)) return;
+
     uint32_t _keyy[4] __attribute__((aligned(32)));
     for (uint32_t i = 0; i < 16u; i++)
         ((uint8_t*)_keyy)[i] = ((uint8_t*)keyy)[i];
@@ -51,6 +57,8 @@ void setup_aeskeyY(uint8_t keyslot, const void* keyy)
 
 void setup_aeskey(uint8_t keyslot, const void* key)
 {
+    if (!aeskeycache_store(keyslot, 'N', key)) return;
+
     uint32_t _key[4] __attribute__((aligned(32)));
     for (uint32_t i = 0; i < 16u; i++)
         ((uint8_t*)_key)[i] = ((uint8_t*)key)[i];
@@ -74,7 +82,7 @@ void setup_aeskey(uint8_t keyslot, const void* key)
 
 void use_aeskey(uint32_t keyno)
 {
-    if (keyno > 0x3F)
+    if ((keyno > 0x3F) || !aeskeycache_select(keyno))
         return;
     *REG_AESKEYSEL = keyno;
     *REG_AESCNT    = *REG_AESCNT | 0x04000000; /* mystery bit */
@@ -93,6 +101,114 @@ void set_ctr(void* iv)
     *(REG_AESCTR + 3) = _iv[0];
 }
 
+#endif
+
+#define AES_KEY_X       (1u << 0) // keyX known
+#define AES_KEY_Y       (1u << 1) // keyY known
+#define AES_KEY_NORMAL  (1u << 2) // normal key set directly and known
+#define AES_KEY_SCRAMB  (1u << 3) // normal key scrambled from the current keyX / keyY
+
+typedef struct {
+    uint8_t keyx[AES_BLOCK_SIZE];
+    uint8_t keyy[AES_BLOCK_SIZE];
+    uint8_t key[AES_BLOCK_SIZE];
+    uint32_t flags;
+} AesKeyCacheSlot;
+
+static AesKeyCacheSlot keycache[0x40];
+static uint32_t keycache_selected = (uint32_t) -1;
+static uint32_t transient_tick[AES_N_TRANSIENT_KEYSLOTS] = { 0 };
+static uint32_t transient_count = 0;
+static AesKeyStats keystats = { 0 };
+
+static int key_equal(const uint8_t* a, const void* b)
+{
+    const uint8_t* b8 = (const uint8_t*) b;
+    uint8_t diff = 0;
+    for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++)
+        diff |= a[i] ^ b8[i];
+    return !diff;
+}
+
+// returns 0 if the key is already in place, records it otherwise
+int aeskeycache_store(uint8_t keyslot, char type, const void* key)
+{
+    if (keyslot > 0x3F) return 1;
+    AesKeyCacheSlot* slot = &(keycache[keyslot]);
+    keystats.key_calls++;
+
+    if (type == 'X') {
+        if ((slot->flags & AES_KEY_X) && key_equal(slot->keyx, key)) {
+            keystats.key_skips++;
+            return 0;
+        }
+        memcpy(slot->keyx, key, AES_BLOCK_SIZE);
+        slot->flags = (slot->flags | AES_KEY_X) & ~AES_KEY_SCRAMB;
+    } else if (type == 'Y') { // writing keyY triggers the key scrambler
+        if ((slot->flags & AES_KEY_SCRAMB) && key_equal(slot->keyy, key)) {
+            keystats.key_skips++;
+            return 0;
+        }
+        memcpy(slot->keyy, key, AES_BLOCK_SIZE);
+        slot->flags = (slot->flags | AES_KEY_Y | AES_KEY_SCRAMB) & ~AES_KEY_NORMAL;
+    } else {
+        if ((slot->flags & AES_KEY_NORMAL) && key_equal(slot->key, key)) {
+            keystats.key_skips++;
+            return 0;
+        }
+        memcpy(slot->key, key, AES_BLOCK_SIZE);
+        slot->flags = (slot->flags | AES_KEY_NORMAL) & ~AES_KEY_SCRAMB;
+    }
+
+    // the engine has to reload this keyslot
+    if (keycache_selected == keyslot)
+        keycache_selected = (uint32_t) -1;
+    return 1;
+}
+
+// returns 0 if the keyslot is already selected and unchanged
+int aeskeycache_select(uint32_t keyno)
+{
+    keystats.use_calls++;
+    if (keycache_selected == keyno) {
+        keystats.use_skips++;
+        return 0;
+    }
+    keycache_selected = keyno;
+    return 1;
+}
+
+uint32_t use_aeskey_transient(const void* key)
+{
+    uint32_t idx = 0;
+    for (uint32_t i = 0; i < AES_N_TRANSIENT_KEYSLOTS; i++) {
+        AesKeyCacheSlot* slot = &(keycache[AES_TRANSIENT_KEYSLOT0 + i]);
+        if ((slot->flags & AES_KEY_NORMAL) && key_equal(slot->key, key)) {
+            idx = i; // already loaded
+            break;
+        }
+        if (transient_tick[i] < transient_tick[idx])
+            idx = i; // least recently used
+    }
+
+    uint32_t keyslot = AES_TRANSIENT_KEYSLOT0 + idx;
+    transient_tick[idx] = ++transient_count;
+    setup_aeskey(keyslot, key);
+    use_aeskey(keyslot);
+    return keyslot;
+}
+
+void reset_aeskeycache(void)
+{
+    memset(keycache, 0x00, sizeof(keycache));
+    keycache_selected = (uint32_t) -1;
+}
+
+void get_aeskeystats(AesKeyStats* stats)
+{
+    memcpy(stats, &keystats, sizeof(AesKeyStats));
+}
+
 void add_ctr(void* ctr, uint32_t carry)
 {
     uint32_t counter[4];
@@ -269,6 +385,7 @@ void ctr_decrypt(void *inbuf, void *outbuf, size_t size, uint32_t mode, uint8_t
     }
 }
 
+#ifndef SOFT_CRYPTO
 void aes_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode)
 {
     uint8_t *in  = inbuf;
@@ -291,6 +408,8 @@ void aes_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode)
     }
 }
 
+#endif
+
 void aes_cmac(void* inbuf, void* outbuf, size_t size)
 {
     // only works for full blocks
@@ -304,8 +423,8 @@ void aes_cmac(void* inbuf, void* outbuf, size_t size)
     // create xorpad for last block
     set_ctr(zeroes);
     aes_decrypt(xorpad, xorpad, 1, mode);
-    char* xorpadb = (void*) xorpad;
-    char finalxor = (xorpadb[0] & 0x80) ? 0x87 : 0x00;
+    uint8_t* xorpadb = (void*) xorpad;
+    uint8_t finalxor = (xorpadb[0] & 0x80) ? 0x87 : 0x00;
     for (uint32_t i = 0; i < 15; i++) {
         xorpadb[i] <<= 1;
         xorpadb[i] |= xorpadb[i+1] >> 7;
@@ -328,6 +447,7 @@ void aes_cmac(void* inbuf, void* outbuf, size_t size)
     }
 }
 
+#ifndef SOFT_CRYPTO
 void aes_fifos(void* inbuf, void* outbuf, size_t blocks)
 {
     if (!inbuf || !outbuf) return;
@@ -405,4 +525,4 @@ uint32_t aescnt_checkread()
     size_t ret = aes_getreadcount();
     return (ret <= 3);
 }
-
+#endif
@@ -48,20 +48,44 @@ extern "C" {
 #define AES_CNT_ECB_DECRYPT_MODE (AES_ECB_DECRYPT_MODE | AES_CNT_INPUT_ORDER | AES_CNT_OUTPUT_ORDER | AES_CNT_INPUT_ENDIAN | AES_CNT_OUTPUT_ENDIAN)
 #define AES_CNT_ECB_ENCRYPT_MODE (AES_ECB_ENCRYPT_MODE | AES_CNT_INPUT_ORDER | AES_CNT_OUTPUT_ORDER | AES_CNT_INPUT_ENDIAN | AES_CNT_OUTPUT_ENDIAN)
 
+// engine interface, backed by the AES hardware (aes.c) or software (aessoft.c, SOFT_CRYPTO)
 void setup_aeskeyX(uint8_t keyslot, const void* keyx);
 void setup_aeskeyY(uint8_t keyslot, const void* keyy);
 void setup_aeskey(uint8_t keyslot, const void* keyy);
 void use_aeskey(uint32_t keyno);
 void set_ctr(void* iv);
+void aes_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode);
+
+// keyslot cache, redundant key writes and key selections are skipped
+// transient (normal) keys are loaded to the least recently used temporary keyslot
+#define AES_TRANSIENT_KEYSLOT0 0x11
+#define AES_N_TRANSIENT_KEYSLOTS 4
+
+typedef struct {
+    uint32_t key_calls; // setup_aeskey*() calls
+    uint32_t key_skips; // ... of which were already loaded
+    uint32_t use_calls; // use_aeskey() calls
+    uint32_t use_skips; // ... of which were already selected
+} AesKeyStats;
+
+uint32_t use_aeskey_transient(const void* key);
+void reset_aeskeycache(void); // required after writing keys without the functions above
+void get_aeskeystats(AesKeyStats* stats);
+int aeskeycache_store(uint8_t keyslot, char type, const void* key); // for the engine backends
+int aeskeycache_select(uint32_t keyno); // for the engine backends
+
+// backend independent modes and helpers
 void add_ctr(void* ctr, uint32_t carry);
 void subtract_ctr(void* ctr, uint32_t carry);
-void aes_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode);
 void ctr_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode, uint8_t *ctr);
 void ctr_decrypt_byte(void *inbuf, void *outbuf, size_t size, size_t off, uint32_t mode, uint8_t *ctr);
 void ecb_decrypt(void *inbuf, void *outbuf, size_t size, uint32_t mode);
 void cbc_decrypt(void *inbuf, void *outbuf, size_t size, uint32_t mode, uint8_t *ctr);
 void cbc_encrypt(void *inbuf, void *outbuf, size_t size, uint32_t mode, uint8_t *ctr);
 void aes_cmac(void* inbuf, void* outbuf, size_t size);
+
+// hardware engine register access, not available with the software engine (SOFT_CRYPTO)
+#ifndef SOFT_CRYPTO
 void aes_fifos(void* inbuf, void* outbuf, size_t blocks);
 void set_aeswrfifo(uint32_t value);
 uint32_t read_aesrdfifo(void);
@@ -69,6 +93,7 @@ uint32_t aes_getwritecount(void);
 uint32_t aes_getreadcount(void);
 uint32_t aescnt_checkwrite(void);
 uint32_t aescnt_checkread(void);
+#endif
 
 #ifdef __cplusplus
 }
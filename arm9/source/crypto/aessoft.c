@@ -0,0 +1,283 @@
+/* software AES engine, replaces the hardware backend in aes.c for SOFT_CRYPTO builds */
+#include "aes.h"
+
+#ifdef SOFT_CRYPTO
+
+#include <string.h>
+
+#define AES_N_KEYSLOTS  0x40
+#define AES_N_ROUNDS    10
+
+// keys, counters and data are kept in the engine's internal (big endian, normal order) layout
+static uint8_t slot_keyx[AES_N_KEYSLOTS][AES_BLOCK_SIZE];
+static uint8_t slot_keyy[AES_N_KEYSLOTS][AES_BLOCK_SIZE];
+static uint8_t slot_key[AES_N_KEYSLOTS][AES_BLOCK_SIZE];
+
+static uint8_t round_keys[(AES_N_ROUNDS + 1) * AES_BLOCK_SIZE];
+static uint8_t aes_ctr[AES_BLOCK_SIZE];
+
+// see: https://www.3dbrew.org/wiki/AES_Registers#Key_Scrambler
+static const uint8_t scrambler_ctr[AES_BLOCK_SIZE] = {
+    0x1F, 0xF9, 0xE9, 0xAA, 0xC5, 0xFE, 0x04, 0x08, 0x02, 0x45, 0x91, 0xDC, 0x5D, 0x52, 0x76, 0x8A
+};
+
+static const uint8_t scrambler_twl[AES_BLOCK_SIZE] = {
+    0xFF, 0xFE, 0xFB, 0x4E, 0x29, 0x59, 0x02, 0x58, 0x2A, 0x68, 0x0F, 0x5F, 0x1A, 0x4F, 0x3E, 0x79
+};
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+static uint8_t inv_sbox[256];
+static uint32_t inv_sbox_ready = 0;
+
+
+static uint8_t xtime(uint8_t x)
+{
+    return (uint8_t) ((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+
+static uint8_t gmul(uint8_t a, uint8_t b)
+{
+    uint8_t res = 0;
+    while (b) {
+        if (b & 1) res ^= a;
+        a = xtime(a);
+        b >>= 1;
+    }
+    return res;
+}
+
+static void expand_key(const uint8_t* key)
+{
+    uint8_t rcon = 0x01;
+
+    if (!inv_sbox_ready) { // first use, build inverse sbox
+        for (uint32_t i = 0; i < 256u; i++)
+            inv_sbox[sbox[i]] = (uint8_t) i;
+        inv_sbox_ready = 1;
+    }
+
+    memcpy(round_keys, key, AES_BLOCK_SIZE);
+    for (uint32_t i = AES_BLOCK_SIZE; i < sizeof(round_keys); i += 4) {
+        uint8_t t[4];
+        memcpy(t, round_keys + i - 4, 4);
+        if (!(i % AES_BLOCK_SIZE)) {
+            uint8_t t0 = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[t0];
+            rcon = xtime(rcon);
+        }
+        for (uint32_t j = 0; j < 4u; j++)
+            round_keys[i + j] = round_keys[i + j - AES_BLOCK_SIZE] ^ t[j];
+    }
+}
+
+static void add_round_key(uint8_t* state, uint32_t round)
+{
+    for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++)
+        state[i] ^= round_keys[(round * AES_BLOCK_SIZE) + i];
+}
+
+static void encrypt_block(uint8_t* state)
+{
+    uint8_t t[AES_BLOCK_SIZE];
+
+    add_round_key(state, 0);
+    for (uint32_t round = 1; round <= AES_N_ROUNDS; round++) {
+        for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++) // sub bytes + shift rows
+            t[i] = sbox[state[(i + ((i % 4) * 4)) % AES_BLOCK_SIZE]];
+        if (round < AES_N_ROUNDS) { // mix columns
+            for (uint32_t c = 0; c < AES_BLOCK_SIZE; c += 4) {
+                uint8_t a0 = t[c], a1 = t[c+1], a2 = t[c+2], a3 = t[c+3];
+                uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+                t[c+0] ^= all ^ xtime(a0 ^ a1);
+                t[c+1] ^= all ^ xtime(a1 ^ a2);
+                t[c+2] ^= all ^ xtime(a2 ^ a3);
+                t[c+3] ^= all ^ xtime(a3 ^ a0);
+            }
+        }
+        memcpy(state, t, AES_BLOCK_SIZE);
+        add_round_key(state, round);
+    }
+}
+
+static void decrypt_block(uint8_t* state)
+{
+    uint8_t t[AES_BLOCK_SIZE];
+
+    add_round_key(state, AES_N_ROUNDS);
+    for (uint32_t round = AES_N_ROUNDS; round > 0; round--) {
+        for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++) // inverse shift rows + inverse sub bytes
+            t[(i + ((i % 4) * 4)) % AES_BLOCK_SIZE] = inv_sbox[state[i]];
+        memcpy(state, t, AES_BLOCK_SIZE);
+        add_round_key(state, round - 1);
+        if (round > 1) { // inverse mix columns
+            for (uint32_t c = 0; c < AES_BLOCK_SIZE; c += 4) {
+                uint8_t a0 = state[c], a1 = state[c+1], a2 = state[c+2], a3 = state[c+3];
+                state[c+0] = gmul(a0, 14) ^ gmul(a1, 11) ^ gmul(a2, 13) ^ gmul(a3, 9);
+                state[c+1] = gmul(a0, 9) ^ gmul(a1, 14) ^ gmul(a2, 11) ^ gmul(a3, 13);
+                state[c+2] = gmul(a0, 13) ^ gmul(a1, 9) ^ gmul(a2, 14) ^ gmul(a3, 11);
+                state[c+3] = gmul(a0, 11) ^ gmul(a1, 13) ^ gmul(a2, 9) ^ gmul(a3, 14);
+            }
+        }
+    }
+}
+
+// converts between external and internal block layout (the conversion is its own inverse)
+static void convert_block(uint8_t* out, const uint8_t* in, uint32_t normal_order, uint32_t big_endian)
+{
+    for (uint32_t w = 0; w < 4u; w++) {
+        uint32_t src = normal_order ? w : 3u - w;
+        for (uint32_t b = 0; b < 4u; b++)
+            out[(w * 4) + b] = in[(src * 4) + (big_endian ? b : 3u - b)];
+    }
+}
+
+static void rol128(uint8_t* val, uint32_t shift)
+{
+    uint8_t tmp[AES_BLOCK_SIZE];
+    uint32_t bytes = (shift / 8) % AES_BLOCK_SIZE;
+    uint32_t bits = shift % 8;
+
+    for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++) {
+        uint8_t hi = val[(i + bytes) % AES_BLOCK_SIZE];
+        uint8_t lo = val[(i + bytes + 1) % AES_BLOCK_SIZE];
+        tmp[i] = bits ? (uint8_t) ((hi << bits) | (lo >> (8 - bits))) : hi;
+    }
+    memcpy(val, tmp, AES_BLOCK_SIZE);
+}
+
+static void add128(uint8_t* val, const uint8_t* add)
+{
+    uint32_t carry = 0;
+    for (int32_t i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+        uint32_t sum = val[i] + add[i] + carry;
+        val[i] = (uint8_t) sum;
+        carry = sum >> 8;
+    }
+}
+
+static void scramble_key(uint8_t keyslot)
+{
+    uint8_t* key = slot_key[keyslot];
+
+    memcpy(key, slot_keyx[keyslot], AES_BLOCK_SIZE);
+    if (keyslot > 3) { // NormalKey = (((KeyX ROL 2) XOR KeyY) + C) ROL 87
+        rol128(key, 2);
+        for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++)
+            key[i] ^= slot_keyy[keyslot][i];
+        add128(key, scrambler_ctr);
+        rol128(key, 87);
+    } else { // NormalKey = ((KeyX XOR KeyY) + C) ROL 42 (TWL)
+        for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++)
+            key[i] ^= slot_keyy[keyslot][i];
+        add128(key, scrambler_twl);
+        rol128(key, 42);
+    }
+}
+
+// TWL keyslots are written without input order / endian flags
+static void load_key(uint8_t* dest, uint8_t keyslot, const void* key)
+{
+    uint32_t twl = (keyslot <= 3);
+    convert_block(dest, (const uint8_t*) key, !twl, !twl);
+}
+
+void setup_aeskeyX(uint8_t keyslot, const void* keyx)
+{
+    if ((keyslot >= AES_N_KEYSLOTS) || !aeskeycache_store(keyslot, 'X', keyx)) return;
+    load_key(slot_keyx[keyslot], keyslot, keyx);
+}
+
+void setup_aeskeyY(uint8_t keyslot, const void* keyy)
+{
+    if ((keyslot >= AES_N_KEYSLOTS) || !aeskeycache_store(keyslot, 'Y', keyy)) return;
+    load_key(slot_keyy[keyslot], keyslot, keyy);
+    scramble_key(keyslot); // writing keyY triggers the key scrambler
+}
+
+void setup_aeskey(uint8_t keyslot, const void* key)
+{
+    if ((keyslot >= AES_N_KEYSLOTS) || !aeskeycache_store(keyslot, 'N', key)) return;
+    load_key(slot_key[keyslot], keyslot, key);
+}
+
+void use_aeskey(uint32_t keyno)
+{
+    if ((keyno >= AES_N_KEYSLOTS) || !aeskeycache_select(keyno))
+        return; // key schedule is still in place
+    expand_key(slot_key[keyno]);
+}
+
+void set_ctr(void* iv)
+{
+    memcpy(aes_ctr, iv, AES_BLOCK_SIZE);
+}
+
+void aes_decrypt(void* inbuf, void* outbuf, size_t size, uint32_t mode)
+{
+    uint8_t *in  = inbuf;
+    uint8_t *out = outbuf;
+    uint32_t method = (mode >> 27) & 0x7;
+    uint8_t block[AES_BLOCK_SIZE];
+    uint8_t temp[AES_BLOCK_SIZE];
+
+    for (size_t n = 0; n < size; n++) {
+        convert_block(block, in, mode & AES_CNT_INPUT_ORDER, mode & AES_CNT_INPUT_ENDIAN);
+        switch (method) {
+            case 2: // CTR
+            case 3:
+                memcpy(temp, aes_ctr, AES_BLOCK_SIZE);
+                encrypt_block(temp);
+                for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++)
+                    block[i] ^= temp[i];
+                add_ctr(aes_ctr, 1);
+                break;
+            case 4: // CBC decrypt
+                memcpy(temp, block, AES_BLOCK_SIZE);
+                decrypt_block(block);
+                for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++)
+                    block[i] ^= aes_ctr[i];
+                memcpy(aes_ctr, temp, AES_BLOCK_SIZE);
+                break;
+            case 5: // CBC encrypt
+                for (uint32_t i = 0; i < AES_BLOCK_SIZE; i++)
+                    block[i] ^= aes_ctr[i];
+                encrypt_block(block);
+                memcpy(aes_ctr, block, AES_BLOCK_SIZE);
+                break;
+            case 6: // ECB decrypt
+                decrypt_block(block);
+                break;
+            case 7: // ECB encrypt
+                encrypt_block(block);
+                break;
+            default: // CCM is not supported, data passes through
+                break;
+        }
+        convert_block(out, block, mode & AES_CNT_OUTPUT_ORDER, mode & AES_CNT_OUTPUT_ENDIAN);
+        in  += AES_BLOCK_SIZE;
+        out += AES_BLOCK_SIZE;
+    }
+}
+
+#endif
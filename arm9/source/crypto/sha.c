@@ -1,6 +1,7 @@
 #include "sha.h"
 #include "mmio.h"
 
+#ifndef SOFT_CRYPTO // see shasoft.c for the software engine
 typedef struct
 {
     u32 data[16];
@@ -35,6 +36,8 @@ void sha_get(void* res) {
     if (hash_size) iomemcpy(res, (void*)REG_SHAHASH, hash_size);
 }
 
+#endif
+
 void sha_quick(void* res, const void* src, u32 size, u32 mode) {
     sha_init(mode);
     sha_update(src, size);
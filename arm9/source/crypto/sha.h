@@ -22,6 +22,7 @@
 #define SHA1_MODE               0x00000020
 
 
+// engine interface, backed by the SHA hardware (sha.c) or software (shasoft.c, SOFT_CRYPTO)
 void sha_init(u32 mode);
 void sha_update(const void* src, u32 size);
 void sha_get(void* res);
@@ -0,0 +1,163 @@
+// software SHA engine, replaces the hardware backend in sha.c for SOFT_CRYPTO builds
+#include "sha.h"
+
+#ifdef SOFT_CRYPTO
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static u32 sha_mode = SHA256_MODE;
+static u32 sha_state[8];
+static u8 sha_buffer[0x40];
+static u32 sha_buffer_len = 0;
+static u64 sha_total_len = 0;
+
+static const u32 sha256_k[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static const u32 sha256_init[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const u32 sha224_init[8] = {
+    0xC1059ED8, 0x367CD507, 0x3070DD17, 0xF70E5939, 0xFFC00B31, 0x68581511, 0x64F98FA7, 0xBEFA4FA4
+};
+
+static const u32 sha1_init[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+
+static void sha256_block(const u8* data)
+{
+    u32 w[64];
+    u32 s[8];
+
+    for (u32 i = 0; i < 16; i++)
+        w[i] = getbe32(data + (i * 4));
+    for (u32 i = 16; i < 64; i++) {
+        u32 s0 = ROR32(w[i-15], 7) ^ ROR32(w[i-15], 18) ^ (w[i-15] >> 3);
+        u32 s1 = ROR32(w[i-2], 17) ^ ROR32(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    memcpy(s, sha_state, sizeof(s));
+    for (u32 i = 0; i < 64; i++) {
+        u32 t1 = s[7] + (ROR32(s[4], 6) ^ ROR32(s[4], 11) ^ ROR32(s[4], 25)) +
+            ((s[4] & s[5]) ^ (~s[4] & s[6])) + sha256_k[i] + w[i];
+        u32 t2 = (ROR32(s[0], 2) ^ ROR32(s[0], 13) ^ ROR32(s[0], 22)) +
+            ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+        memmove(s + 1, s, 7 * sizeof(u32));
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+
+    for (u32 i = 0; i < 8; i++)
+        sha_state[i] += s[i];
+}
+
+static void sha1_block(const u8* data)
+{
+    u32 w[80];
+    u32 a = sha_state[0], b = sha_state[1], c = sha_state[2], d = sha_state[3], e = sha_state[4];
+
+    for (u32 i = 0; i < 16; i++)
+        w[i] = getbe32(data + (i * 4));
+    for (u32 i = 16; i < 80; i++)
+        w[i] = ROL32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+    for (u32 i = 0; i < 80; i++) {
+        u32 f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        u32 t = ROL32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROL32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    sha_state[0] += a;
+    sha_state[1] += b;
+    sha_state[2] += c;
+    sha_state[3] += d;
+    sha_state[4] += e;
+}
+
+static void sha_block(const u8* data)
+{
+    if (sha_mode & SHA1_MODE) sha1_block(data);
+    else sha256_block(data);
+}
+
+void sha_init(u32 mode)
+{
+    sha_mode = mode & SHA_CNT_MODE;
+    if (sha_mode & SHA1_MODE) memcpy(sha_state, sha1_init, sizeof(sha1_init));
+    else if (sha_mode & SHA224_MODE) memcpy(sha_state, sha224_init, sizeof(sha224_init));
+    else memcpy(sha_state, sha256_init, sizeof(sha256_init));
+    sha_buffer_len = 0;
+    sha_total_len = 0;
+}
+
+void sha_update(const void* src, u32 size)
+{
+    const u8* src8 = (const u8*) src;
+    sha_total_len += size;
+
+    if (sha_buffer_len) {
+        u32 fill = min(size, 0x40 - sha_buffer_len);
+        memcpy(sha_buffer + sha_buffer_len, src8, fill);
+        sha_buffer_len += fill;
+        src8 += fill;
+        size -= fill;
+        if (sha_buffer_len < 0x40) return;
+        sha_block(sha_buffer);
+        sha_buffer_len = 0;
+    }
+
+    for (; size >= 0x40; src8 += 0x40, size -= 0x40)
+        sha_block(src8);
+
+    if (size) {
+        memcpy(sha_buffer, src8, size);
+        sha_buffer_len = size;
+    }
+}
+
+void sha_get(void* res) {
+    u32 hash_size = (sha_mode & SHA224_MODE) ? (224/8) :
+                    (sha_mode & SHA1_MODE) ? (160/8) : (256/8);
+    u64 bit_len = sha_total_len * 8;
+    u8 pad[0x48] = { 0x80 };
+    u32 pad_len = ((sha_buffer_len < 0x38) ? 0x38 : 0x78) - sha_buffer_len;
+
+    for (u32 i = 0; i < 8; i++)
+        pad[pad_len + i] = (u8) (bit_len >> (56 - (i * 8)));
+    sha_update(pad, pad_len + 8);
+
+    for (u32 i = 0; i < hash_size; i++)
+        ((u8*) res)[i] = (u8) (sha_state[i / 4] >> (24 - ((i % 4) * 8)));
+}
+
+#endif
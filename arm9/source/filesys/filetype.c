@@ -11,8 +11,31 @@
 #include "gm9lua.h"
 #include "png.h"
 #include "ui.h" // only for font file detection
+#include "virtual.h"
+#include "vff.h"
 
-u64 IdentifyFileType(const char* path) {
+#define FTYPE_CACHE_SIZE    64
+
+typedef struct {
+    char path[256];
+    u64 fsize;
+    u16 fdate;
+    u16 ftime;
+    u64 type;
+    u32 gen; // cache generation the entry belongs to
+    u32 tick; // last use, for LRU eviction
+} FileTypeCacheEntry;
+
+static FileTypeCacheEntry ftype_cache[FTYPE_CACHE_SIZE];
+static u32 ftype_cache_gen = 1; // entries from older generations are invalid
+static u32 ftype_cache_tick = 0;
+
+
+void InvalidateFileTypeCache(void) {
+    ftype_cache_gen++;
+}
+
+static u64 IdentifyFileTypeWorker(const char* path, size_t fsize) {
     static const u8 romfs_magic[] = { ROMFS_MAGIC };
     static const u8 diff_magic[] = { DIFF_MAGIC };
     static const u8 disa_magic[] = { DISA_MAGIC };
@@ -21,10 +44,8 @@ u64 IdentifyFileType(const char* path) {
     static const u8 threedsx_magic[] = { THREEDSX_EXT_MAGIC };
     static const u8 png_magic[] = { PNG_MAGIC };
 
-    if (!path) return 0; // safety
     u8 ALIGN(32) header[0x2C0]; // minimum required size
     void* data = (void*) header;
-    size_t fsize = FileGetSize(path);
     char* fname = strrchr(path, '/');
     char* ext = (fname) ? strrchr(++fname, '.') : NULL;
     u32 id = 0;
@@ -192,3 +213,41 @@ u64 IdentifyFileType(const char* path) {
 
     return 0;
 }
+
+u64 IdentifyFileType(const char* path) {
+    FILINFO fno;
+    if (!path) return 0; // safety
+
+    // virtual files are not cached, their contents change with what is mounted
+    if (GetVirtualSource(path)) return IdentifyFileTypeWorker(path, FileGetSize(path));
+    if ((fvx_stat(path, &fno) != FR_OK) || (fno.fattrib & AM_DIR)) return 0;
+
+    // known and unchanged?
+    u32 victim = 0;
+    for (u32 i = 0; i < FTYPE_CACHE_SIZE; i++) {
+        FileTypeCacheEntry* entry = &(ftype_cache[i]);
+        if ((entry->gen == ftype_cache_gen) && (entry->fsize == fno.fsize) &&
+            (entry->fdate == fno.fdate) && (entry->ftime == fno.ftime) &&
+            (strncmp(entry->path, path, 256) == 0)) {
+            entry->tick = ++ftype_cache_tick;
+            return entry->type;
+        }
+        if ((ftype_cache[victim].gen == ftype_cache_gen) &&
+            ((entry->gen != ftype_cache_gen) || (entry->tick < ftype_cache[victim].tick)))
+            victim = i; // invalid entries first, then least recently used
+    }
+
+    u64 type = IdentifyFileTypeWorker(path, fno.fsize);
+
+    FileTypeCacheEntry* entry = &(ftype_cache[victim]);
+    strncpy(entry->path, path, 256);
+    entry->path[255] = '\0';
+    entry->fsize = fno.fsize;
+    entry->fdate = fno.fdate;
+    entry->ftime = fno.ftime;
+    entry->type = type;
+    entry->gen = ftype_cache_gen;
+    entry->tick = ++ftype_cache_tick;
+
+    return type;
+}
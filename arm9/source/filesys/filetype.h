@@ -89,3 +89,4 @@
 #define FTYPE_AGBSAVE(tp)       (tp&(SYS_AGBSAVE))
 
 u64 IdentifyFileType(const char* path);
+void InvalidateFileTypeCache(void);
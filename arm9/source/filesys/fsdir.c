@@ -1,8 +1,105 @@
 #include "fsdir.h"
 
-void DirEntryCpy(DirEntry* dest, const DirEntry* orig) {
-    memcpy(dest, orig, sizeof(DirEntry));
-    dest->name = dest->path + dest->p_name;
+#define DIR_ENTRIES_INIT    256
+
+static DirEntry* sort_entries = NULL; // for compDirEntryIndex()
+
+
+void InitDirStruct(DirStruct* contents) {
+    memset(contents, 0x00, sizeof(DirStruct));
+}
+
+void FreeDirStruct(DirStruct* contents) {
+    for (DirArena* arena = contents->arena; arena;) {
+        DirArena* next = arena->next;
+        free(arena);
+        arena = next;
+    }
+    if (contents->entry) free(contents->entry);
+    InitDirStruct(contents);
+}
+
+static char* InternString(DirStruct* contents, const char* str) {
+    u32 len = strnlen(str, 255) + 1;
+
+    // move on to the next chunk, allocate a new one if required
+    DirArena* arena = contents->arena_curr;
+    if (!arena || (arena->used + len > DIR_ARENA_SIZE)) {
+        DirArena* next = (arena) ? arena->next : contents->arena;
+        if (!next) {
+            next = (DirArena*) malloc(sizeof(DirArena));
+            if (!next) return NULL;
+            next->next = NULL;
+            if (arena) arena->next = next;
+            else contents->arena = next;
+        }
+        next->used = 0;
+        arena = contents->arena_curr = next;
+    }
+
+    char* istr = arena->data + arena->used;
+    memcpy(istr, str, len - 1);
+    istr[len - 1] = '\0';
+    arena->used += len;
+    return istr;
+}
+
+DirEntry* AddDirEntry(DirStruct* contents, const char* path, const char* name, u64 size, EntryType type) {
+    // recycle the arena for a fresh listing
+    if (!contents->n_entries) {
+        for (DirArena* arena = contents->arena; arena; arena = arena->next)
+            arena->used = 0;
+        contents->arena_curr = contents->arena;
+    }
+
+    // grow the entry array
+    if (contents->n_entries >= contents->n_alloc) {
+        u32 n_alloc = (contents->n_alloc) ? contents->n_alloc * 2 : DIR_ENTRIES_INIT;
+        DirEntry* entry = (DirEntry*) realloc(contents->entry, n_alloc * sizeof(DirEntry));
+        if (!entry) return NULL;
+        contents->entry = entry;
+        contents->n_alloc = n_alloc;
+    }
+
+    DirEntry* entry = &(contents->entry[contents->n_entries]);
+    entry->path = InternString(contents, path);
+    if (!entry->path) return NULL;
+    if (name) entry->name = InternString(contents, name);
+    else {
+        char* slash = strrchr(entry->path, '/');
+        entry->name = (slash) ? slash + 1 : entry->path;
+    }
+    if (!entry->name) return NULL;
+    entry->size = size;
+    entry->type = type;
+    entry->marked = 0;
+
+    contents->n_entries++;
+    return entry;
+}
+
+bool SetDirEntryPath(DirStruct* contents, DirEntry* entry, const char* path) {
+    char* ipath = InternString(contents, path);
+    if (!ipath) return false;
+    char* slash = strrchr(ipath, '/');
+    entry->path = ipath;
+    entry->name = (slash) ? slash + 1 : ipath;
+    return true;
+}
+
+bool SetDirEntryName(DirStruct* contents, DirEntry* entry, const char* name) {
+    char* iname = InternString(contents, name);
+    if (!iname) return false;
+    entry->name = iname;
+    return true;
+}
+
+bool DirEntryCpy(DirStruct* dest, const DirEntry* orig) {
+    bool sep_name = (orig->name < orig->path) || (orig->name > orig->path + strnlen(orig->path, 256));
+    DirEntry* entry = AddDirEntry(dest, orig->path, sep_name ? orig->name : NULL, orig->size, orig->type);
+    if (!entry) return false;
+    entry->marked = orig->marked;
+    return true;
 }
 
 int compDirEntry(const void* e1, const void* e2) {
@@ -15,11 +112,29 @@ int compDirEntry(const void* e1, const void* e2) {
     return strncasecmp(entry1->path, entry2->path, 256);
 }
 
+static int compDirEntryIndex(const void* i1, const void* i2) {
+    return compDirEntry(&(sort_entries[*(const u32*) i1]), &(sort_entries[*(const u32*) i2]));
+}
+
 void SortDirStruct(DirStruct* contents) {
-    qsort(contents->entry, contents->n_entries, sizeof(DirEntry), compDirEntry);
-    // fix entry->names after qsort
-    for (int i = 0; i < (int)contents->n_entries; i++) {
-        DirEntry* entry = &(contents->entry[i]);
-        entry->name = entry->path + entry->p_name;
+    u32 n_entries = contents->n_entries;
+    u32* index = (u32*) malloc(n_entries * sizeof(u32));
+    DirEntry* sorted = (DirEntry*) malloc(contents->n_alloc * sizeof(DirEntry));
+
+    if (!index || !sorted) { // sort in place if there is no memory for the index
+        qsort(contents->entry, n_entries, sizeof(DirEntry), compDirEntry);
+    } else {
+        for (u32 i = 0; i < n_entries; i++) index[i] = i;
+        sort_entries = contents->entry;
+        qsort(index, n_entries, sizeof(u32), compDirEntryIndex);
+        sort_entries = NULL;
+        for (u32 i = 0; i < n_entries; i++)
+            sorted[i] = contents->entry[index[i]];
+        free(contents->entry);
+        contents->entry = sorted;
+        sorted = NULL;
     }
+
+    if (index) free(index);
+    if (sorted) free(sorted);
 }
@@ -2,7 +2,7 @@
 
 #include "common.h"
 
-#define MAX_DIR_ENTRIES 2048
+#define DIR_ARENA_SIZE      0x4000 // string arena chunk size, fits any path
 
 typedef enum {
     T_ROOT,
@@ -12,18 +12,33 @@ typedef enum {
 } EntryType;
 
 typedef struct {
-    char* name; // should point to the correct portion of the path
-    char path[256];
+    char* name; // points to the correct portion of the path or a separate string
+    char* path; // interned in the string arena of the DirStruct
     u64 size;
     EntryType type;
     u8 marked;
-    u8 p_name;
 } DirEntry;
 
+typedef struct DirArena {
+    struct DirArena* next;
+    u32 used;
+    char data[DIR_ARENA_SIZE];
+} DirArena;
+
+// entries grow as needed, strings are packed into a chain of arena chunks
+// the arena is recycled when adding to an empty DirStruct (n_entries == 0)
 typedef struct {
     u32 n_entries;
-    DirEntry entry[MAX_DIR_ENTRIES];
+    u32 n_alloc;
+    DirEntry* entry;
+    DirArena* arena;
+    DirArena* arena_curr;
 } DirStruct;
 
-void DirEntryCpy(DirEntry* dest, const DirEntry* orig);
+void InitDirStruct(DirStruct* contents);
+void FreeDirStruct(DirStruct* contents);
+DirEntry* AddDirEntry(DirStruct* contents, const char* path, const char* name, u64 size, EntryType type);
+bool SetDirEntryPath(DirStruct* contents, DirEntry* entry, const char* path);
+bool SetDirEntryName(DirStruct* contents, DirEntry* entry, const char* name);
+bool DirEntryCpy(DirStruct* dest, const DirEntry* orig);
 void SortDirStruct(DirStruct* contents);
@@ -8,12 +8,18 @@
 #include "image.h"
 #include "ui.h"
 #include "vff.h"
+#include "diskio.h"
 
 // last search pattern, path & mode
 static char search_pattern[256] = { 0 };
 static char search_path[256] = { 0 };
 static bool title_manager_mode = false;
 
+// directory listing that is filled in slices
+static DIR lazy_dir;
+static char lazy_path[256] = { 0 };
+static DirStruct* lazy_contents = NULL;
+
 int DriveType(const char* path) {
     int type = DRV_UNKNOWN;
     int pdrv = GetMountedFSNum(path);
@@ -87,7 +93,6 @@ bool GetFATVolumeLabel(const char* drv, char* label) {
 bool GetRootDirContentsWorker(DirStruct* contents) {
     const char* drvname[] = { FS_DRVNAME };
     static const char* drvnum[] = { FS_DRVNUM };
-    u32 n_entries = 0;
 
     char sdlabel[DRV_LABEL_LEN];
     if (!GetFATVolumeLabel("0:", sdlabel) || !(*sdlabel))
@@ -97,20 +102,17 @@ bool GetRootDirContentsWorker(DirStruct* contents) {
     GetVCartTypeString(carttype);
 
     // virtual root objects hacked in
-    for (u32 i = 0; (i < countof(drvnum)) && (n_entries < MAX_DIR_ENTRIES); i++) {
-        DirEntry* entry = &(contents->entry[n_entries]);
+    contents->n_entries = 0;
+    for (u32 i = 0; i < countof(drvnum); i++) {
+        char name[252];
         if (!DriveType(drvnum[i])) continue; // drive not available
-        entry->p_name = 4;
-        entry->name = entry->path + entry->p_name;
-        memset(entry->path, 0x00, 256);
-        snprintf(entry->path,  4, "%s", drvnum[i]);
         if ((*(drvnum[i]) >= '7') && (*(drvnum[i]) <= '9') && !(GetMountState() & IMG_NAND)) // Drive 7...9 handling
-            snprintf(entry->name, 252, "[%s] %s", drvnum[i],
+            snprintf(name, sizeof(name), "[%s] %s", drvnum[i],
                 (*(drvnum[i]) == '7') ? STR_LAB_FAT_IMAGE :
                 (*(drvnum[i]) == '8') ? STR_LAB_BONUS_DRIVE :
                 (*(drvnum[i]) == '9') ? STR_LAB_RAMDRIVE : "UNK");
         else if (*(drvnum[i]) == 'G') // Game drive special handling
-            snprintf(entry->name, 252, "[%s] %s %s", drvnum[i],
+            snprintf(name, sizeof(name), "[%s] %s %s", drvnum[i],
                 (GetMountState() & GAME_CIA  ) ? "CIA"   :
                 (GetMountState() & GAME_NCSD ) ? "NCSD"  :
                 (GetMountState() & GAME_NCCH ) ? "NCCH"  :
@@ -120,20 +122,17 @@ bool GetRootDirContentsWorker(DirStruct* contents) {
                 (GetMountState() & SYS_FIRM  ) ? "FIRM"  :
                 (GetMountState() & GAME_TAD  ) ? "DSIWARE" : "UNK", drvname[i]);
         else if (*(drvnum[i]) == 'C') // Game cart handling
-            snprintf(entry->name, 252, "[%s] %s (%s)", drvnum[i], drvname[i], carttype);
+            snprintf(name, sizeof(name), "[%s] %s (%s)", drvnum[i], drvname[i], carttype);
         else if (*(drvnum[i]) == '0') // SD card handling
-            snprintf(entry->name, 252, "[%s] %s (%s)", drvnum[i], drvname[i], sdlabel);
+            snprintf(name, sizeof(name), "[%s] %s (%s)", drvnum[i], drvname[i], sdlabel);
         else if (*(drvnum[i]) == 'F') // Save/Extdata handling
-            snprintf(entry->name, 252, "[%s] %s", drvnum[i],
+            snprintf(name, sizeof(name), "[%s] %s", drvnum[i],
                (GetMountState() & SYS_DIFF) ? STR_LAB_EXTDATA_IMAGE :
                (GetMountState() & SYS_DISA) ? STR_LAB_SAVE_FILE_IMAGE : "UNK");
-        else snprintf(entry->name, 252, "[%s] %s", drvnum[i], drvname[i]);
-        entry->size = GetTotalSpace(entry->path);
-        entry->type = T_ROOT;
-        entry->marked = 0;
-        n_entries++;
+        else snprintf(name, sizeof(name), "[%s] %s", drvnum[i], drvname[i]);
+        if (!AddDirEntry(contents, drvnum[i], name, GetTotalSpace(drvnum[i]), T_ROOT))
+            break;
     }
-    contents->n_entries = n_entries;
 
     return contents->n_entries;
 }
@@ -160,25 +159,12 @@ bool GetDirContentsWorker(DirStruct* contents, char* fpath, int fnsize, const ch
             ret = true;
             break;
         } else if (!pattern || (fvx_match_name(fname, pattern) == FR_OK)) {
-            DirEntry* entry = &(contents->entry[contents->n_entries]);
-            if (contents->n_entries >= MAX_DIR_ENTRIES) {
-                ret = true; // Too many entries, still okay if we stop here
+            bool is_dir = fno.fattrib & AM_DIR;
+            if ((!recursive || !is_dir) &&
+                !AddDirEntry(contents, fpath, NULL, is_dir ? 0 : fno.fsize, is_dir ? T_DIR : T_FILE)) {
+                ret = true; // out of memory, still okay if we stop here
                 break;
             }
-            strncpy(entry->path, fpath, 256);
-            entry->path[255] = '\0';
-            entry->p_name = fname - fpath;
-            entry->name = entry->path + entry->p_name;
-            if (fno.fattrib & AM_DIR) {
-                entry->type = T_DIR;
-                entry->size = 0;
-            } else {
-                entry->type = T_FILE;
-                entry->size = fno.fsize;
-            }
-            entry->marked = 0;
-            if (!recursive || (entry->type != T_DIR))
-                ++(contents->n_entries);
         }
         if (recursive && (fno.fattrib & AM_DIR)) {
             if (!GetDirContentsWorker(contents, fpath, fnsize, pattern, recursive))
@@ -197,14 +183,8 @@ void SearchDirContents(DirStruct* contents, const char* path, const char* patter
             contents->n_entries = 0; // not required, but so what?
     } else {
         // create virtual '..' entry
-        DirEntry* entry = (DirEntry*) &(contents->entry);
-        entry->p_name = 4;
-        entry->name = entry->path + entry->p_name;
-        strncpy(entry->path, "*?*", 4);
-        strncpy(entry->name, "..", 4);
-        entry->type = T_DOTDOT;
-        entry->size = 0;
-        contents->n_entries = 1;
+        if (!AddDirEntry(contents, "*?*", "..", 0, T_DOTDOT))
+            return;
         // search the path
         char fpath[256]; // 256 is the maximum length of a full path
         strncpy(fpath, path, 256);
@@ -214,7 +194,72 @@ void SearchDirContents(DirStruct* contents, const char* path, const char* patter
     }
 }
 
+static void StopLazyDirContents(void) {
+    if (!lazy_contents) return;
+    fvx_closedir(&lazy_dir);
+    lazy_contents = NULL;
+}
+
+static bool LazyDirContentsWorker(DirStruct* contents, u32 n_max) {
+    FILINFO fno;
+    char fpath[256];
+    char* fname;
+
+    strncpy(fpath, lazy_path, 256);
+    fpath[255] = '\0';
+    fname = fpath + strnlen(fpath, 255);
+    if (*(fname-1) != '/') *(fname++) = '/';
+
+    for (u32 n = 0; n < n_max;) {
+        if ((fvx_readdir(&lazy_dir, &fno) != FR_OK) || (fno.fname[0] == 0))
+            return false; // end of dir
+        if ((strncmp(fno.fname, ".", 2) == 0) || (strncmp(fno.fname, "..", 3) == 0))
+            continue; // filter out virtual entries
+        #ifdef HIDE_HIDDEN
+        if (fno.fattrib & AM_HID)
+            continue; // filter out hidden entries
+        #endif
+        strncpy(fname, fno.fname, (256 - 1) - (fname - fpath));
+        bool is_dir = fno.fattrib & AM_DIR;
+        if (!AddDirEntry(contents, fpath, NULL, is_dir ? 0 : fno.fsize, is_dir ? T_DIR : T_FILE))
+            return false; // out of memory, stop here
+        n++;
+    }
+
+    return true;
+}
+
+bool GetDirContentsLazy(DirStruct* contents, const char* path) {
+    StopLazyDirContents();
+
+    // root, search and title manager listings are always read in one go
+    if (!*path || (DriveType(path) & (DRV_SEARCH|DRV_TITLEMAN))) {
+        GetDirContents(contents, path);
+        return false;
+    }
+
+    contents->n_entries = 0;
+    if ((fvx_opendir(&lazy_dir, path) != FR_OK) || !AddDirEntry(contents, "*?*", "..", 0, T_DOTDOT)) {
+        contents->n_entries = 0;
+        return false;
+    }
+    strncpy(lazy_path, path, 256);
+    lazy_path[255] = '\0';
+    lazy_contents = contents;
+
+    return FillDirContents(contents);
+}
+
+bool FillDirContents(DirStruct* contents) {
+    if (!lazy_contents || (lazy_contents != contents)) return false;
+    bool more = LazyDirContentsWorker(contents, DIR_LAZY_SLICE);
+    SortDirStruct(contents);
+    if (!more) StopLazyDirContents();
+    return more;
+}
+
 void GetDirContents(DirStruct* contents, const char* path) {
+    StopLazyDirContents();
     if (*search_path && (DriveType(path) & DRV_SEARCH)) {
         ShowString("%s", STR_SEARCHING_PLEASE_WAIT);
         SearchDirContents(contents, search_path, search_pattern, true);
@@ -227,6 +272,45 @@ void GetDirContents(DirStruct* contents, const char* path) {
     if (*path) SortDirStruct(contents);
 }
 
+// count free clusters from large FAT reads, f_getfree() reads one sector at a time (FAT16 / FAT32 only)
+static bool ScanFreeClusters(FATFS* fsobj)
+{
+    if ((fsobj->fs_type != FS_FAT16) && (fsobj->fs_type != FS_FAT32))
+        return false;
+
+    u8* buffer = (u8*) malloc(STD_BUFFER_SIZE);
+    if (!buffer) return false;
+
+    const u32 entry_size = (fsobj->fs_type == FS_FAT16) ? 2 : 4;
+    const u32 n_sectors = ((fsobj->n_fatent * entry_size) + FF_MAX_SS - 1) / FF_MAX_SS;
+    u32 n_free = 0;
+    u32 clst = 0;
+    bool ok = true;
+    for (u32 s = 0; (s < n_sectors) && ok; s += STD_BUFFER_SIZE / FF_MAX_SS) {
+        u32 count = min(STD_BUFFER_SIZE / FF_MAX_SS, n_sectors - s);
+        LBA_t sector = fsobj->fatbase + s;
+        if (disk_read(fsobj->pdrv, buffer, sector, count) != RES_OK) {
+            ok = false;
+            break;
+        }
+        // the FatFs window may hold a newer, not yet written copy of one FAT sector
+        if (fsobj->wflag && (fsobj->winsect >= sector) && (fsobj->winsect < sector + count))
+            memcpy(buffer + ((fsobj->winsect - sector) * FF_MAX_SS), fsobj->win, FF_MAX_SS);
+        for (u32 i = 0; (i < count * FF_MAX_SS) && (clst < fsobj->n_fatent); i += entry_size, clst++) {
+            u32 entry = (entry_size == 2) ? (u32) getle16(buffer + i) : (getle32(buffer + i) & 0x0FFFFFFF);
+            if (!entry) n_free++;
+        }
+    }
+    free(buffer);
+
+    // from here on FatFs keeps the count up to date on allocation / removal
+    if (ok) {
+        fsobj->free_clst = n_free;
+        fsobj->fsi_flag |= 1; // FAT32: FSInfo is updated on next sync
+    }
+    return ok;
+}
+
 uint64_t GetFreeSpace(const char* path)
 {
     DWORD free_clusters;
@@ -236,9 +320,12 @@ uint64_t GetFreeSpace(const char* path)
     FATFS* fsobj = GetMountedFSObject(path);
     if ((pdrv < 0) || !fsobj) return 0;
 
-    snprintf(fsname, sizeof(fsname), "%i:", pdrv);
-    if (f_getfree(fsname, &free_clusters, &fsptr) != FR_OK)
-        return 0;
+    // free cluster count is only unknown after mounting (no or invalid FSInfo)
+    if ((fsobj->free_clst > fsobj->n_fatent - 2) && !ScanFreeClusters(fsobj)) {
+        snprintf(fsname, sizeof(fsname), "%i:", pdrv);
+        if (f_getfree(fsname, &free_clusters, &fsptr) != FR_OK)
+            return 0;
+    } else free_clusters = fsobj->free_clst;
 
     return (uint64_t) free_clusters * fsobj->csize * FF_MAX_SS;
 }
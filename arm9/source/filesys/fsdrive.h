@@ -6,6 +6,8 @@
 #define NORM_FS  10
 #define IMGN_FS  3 // image normal filesystems
 
+#define DIR_LAZY_SLICE  64 // entries per slice of a lazy listing
+
 // primary drive types
 #define DRV_UNKNOWN     (0<<0)
 #define DRV_FAT         (1UL<<0)
@@ -62,6 +64,12 @@ bool GetFATVolumeLabel(const char* drv, char* label);
 /** Get directory content under a given path **/
 void GetDirContents(DirStruct* contents, const char* path);
 
+/** Get the first slice of directory content, returns true if more entries are pending **/
+bool GetDirContentsLazy(DirStruct* contents, const char* path);
+
+/** Add and sort in the next slice of a lazy listing, returns true if more entries are pending **/
+bool FillDirContents(DirStruct* contents);
+
 /** Gets remaining space in filesystem in bytes */
 uint64_t GetFreeSpace(const char* path);
 
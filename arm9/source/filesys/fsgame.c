@@ -3,32 +3,31 @@
 #include "gameutil.h"
 #include "language.h"
 #include "tie.h"
+#include "titlecache.h"
 #include "ui.h"
 #include "vff.h"
 
 void SetupTitleManager(DirStruct* contents) {
     char goodname[256];
     ShowProgress(0, 0, "");
+    OpenTitleCache();
     for (u32 s = 0; s < contents->n_entries; s++) {
         DirEntry* entry = &(contents->entry[s]);
-        // set good name for entry
-        u32 plen = strnlen(entry->path, 256);
         if (!ShowProgress(s+1, contents->n_entries, entry->path)) break;
-        if ((GetGoodName(goodname, entry->path, false) != 0) ||
-            (plen + 1 + strnlen(goodname, 256) + 1 > 256))
-            continue;
-        entry->p_name = plen + 1;
-        entry->name = entry->path + entry->p_name;
-        snprintf(entry->name, 256 - entry->p_name, "%s", goodname);
-        // grab title size from tie
+        // grab tie, also used to validate the cached good name
         TitleInfoEntry tie;
         if (fvx_qread(entry->path, &tie, 0, sizeof(TitleInfoEntry), NULL) != FR_OK)
             continue;
+        // set good name and title size for entry
+        if ((GetTieGoodNameCached(goodname, entry->path, &tie) != 0) ||
+            !SetDirEntryName(contents, entry, goodname))
+            continue;
         entry->size = tie.title_size;
     }
+    CloseTitleCache();
 }
 
-bool GoodRenamer(DirEntry* entry, bool ask) {
+bool GoodRenamer(DirStruct* contents, DirEntry* entry, bool ask) {
     char goodname[256]; // get goodname
     if ((GetGoodName(goodname, entry->path, false) != 0) ||
         (strncmp(goodname + strnlen(goodname, 256) - 4, ".tmd", 4) == 0)) // no TMD, please
@@ -53,8 +52,7 @@ bool GoodRenamer(DirEntry* entry, bool ask) {
     // actual rename
     if (!CheckDirWritePermissions(entry->path)) return false;
     if (f_rename(entry->path, npath) != FR_OK) return false;
-    strncpy(entry->path, npath, 256);
-    entry->name = entry->path + (nname - npath);
+    SetDirEntryPath(contents, entry, npath);
 
     return true;
 }
@@ -52,6 +52,7 @@ bool InitImgFS(const char* path) {
     // deinit image filesystem
     DismountDriveType(DRV_IMAGE);
     // (re)mount image, done if path == NULL
+    InvalidateFileTypeCache();
     u64 type = MountImage(path);
     InitVirtualImageDrive();
     if ((type&IMG_NAND) && (drv_i < NORM_FS)) drv_i = NORM_FS;
@@ -66,6 +67,7 @@ bool InitImgFS(const char* path) {
 
 void DeinitExtFS() {
     InitImgFS(NULL);
+    CloseImageSlots(NULL);
     SetupNandSdDrive(NULL, NULL, NULL, 0);
     SetupNandSdDrive(NULL, NULL, NULL, 1);
     for (u32 i = NORM_FS - 1; i > 0; i--) {
@@ -83,6 +85,13 @@ void DeinitSDCardFS() {
 }
 
 void DismountDriveType(u32 type) { // careful with this - no safety checks
+    InvalidateFileTypeCache();
+    for (int i = IMG_SLOT_DRIVE + 1; i < IMG_N_SLOTS; i++) { // lookup images on affected drives
+        char path[256];
+        strncpy(path, GetImageSlotPath(i), 256);
+        if (GetImageSlotState(i) && (type & DriveType(path)))
+            CloseImageSlots(path);
+    }
     if (type & DriveType(GetMountPath()))
         InitImgFS(NULL); // image is mounted from type -> unmount image drive, too
     if (type & DRV_SDCARD) {
@@ -18,6 +18,9 @@
 #define OVERWRITE_CUR   (1UL<<12)
 
 #define _MAX_FS_OPT     8 // max file selector options
+#define _MAX_FS_SCROLL  2048 // max file scroll selector options
+
+#define COPY_BUFFER_MAX (4 * STD_BUFFER_SIZE) // max copy buffer size
 
 // Volume2Partition resolution table
 PARTITION VolToPart[] = {
@@ -203,6 +206,24 @@ bool FileGetSha(const char* path, u8* hash, u64 offset, u64 size, bool sha1) {
     return ret;
 }
 
+// Boyer-Moore-Horspool search in memory, returns offset of the first match or (u32) -1
+static u32 FindDataInBuffer(const u8* buffer, u32 size, const u8* data, u32 size_data, const u32* skip) {
+    if (!size_data) return 0;
+    if (size_data > size) return (u32) -1;
+    if (size_data == 1) {
+        const u8* found = (const u8*) memchr(buffer, *data, size);
+        return found ? (u32) (found - buffer) : (u32) -1;
+    }
+
+    const u8 last = data[size_data - 1];
+    for (u32 i = 0; i + size_data <= size; i += skip[buffer[i + size_data - 1]]) {
+        if ((buffer[i + size_data - 1] == last) && (memcmp(buffer + i, data, size_data - 1) == 0))
+            return i;
+    }
+
+    return (u32) -1;
+}
+
 u32 FileFindData(const char* path, u8* data, u32 size_data, u32 offset_file) {
     FIL file; // used for FAT & virtual
     u64 found = (u64) -1;
@@ -214,6 +235,11 @@ u32 FileFindData(const char* path, u8* data, u32 size_data, u32 offset_file) {
     u8* buffer = (u8*) malloc(STD_BUFFER_SIZE);
     if (!buffer) return false;
 
+    // bad character skip table for the search
+    u32 skip[256];
+    for (u32 c = 0; c < 256; c++) skip[c] = size_data;
+    for (u32 i = 0; i + 1 < size_data; i++) skip[data[i]] = size_data - 1 - i;
+
     // main routine
     for (u32 pass = 0; pass < 2; pass++) {
         bool show_progress = false;
@@ -226,12 +252,8 @@ u32 FileFindData(const char* path, u8* data, u32 size_data, u32 offset_file) {
             fvx_lseek(&file, pos);
             if ((fvx_read(&file, buffer, read_bytes, &btr) != FR_OK) || (btr != read_bytes))
                 break;
-            for (u32 i = 0; i + size_data <= read_bytes; i++) {
-                if (memcmp(buffer + i, data, size_data) == 0) {
-                    found = pos + i;
-                    break;
-                }
-            }
+            u32 i = FindDataInBuffer(buffer, read_bytes, data, size_data, skip);
+            if (i != (u32) -1) found = pos + i;
             if (!show_progress && (found == (u64) -1) && (pos + read_bytes < fsize)) {
                 ShowProgress(0, 0, path);
                 show_progress = true;
@@ -447,6 +469,17 @@ bool PathExist(const char* path) {
     return (fvx_stat(path, NULL) == FR_OK);
 }
 
+// largest copy buffer that fits into free memory (at least STD_BUFFER_SIZE)
+static u8* AllocCopyBuffer(u32* bufsiz) {
+    for (u32 size = COPY_BUFFER_MAX; size >= STD_BUFFER_SIZE; size >>= 1) {
+        u8* buffer = (u8*) malloc(size);
+        if (!buffer) continue;
+        *bufsiz = size;
+        return buffer;
+    }
+    return NULL;
+}
+
 bool PathMoveCopyRec(char* dest, char* orig, u32* flags, bool move, u8* buffer, u32 bufsiz) {
     bool to_virtual = GetVirtualSource(dest);
     bool silent = (flags && (*flags & SILENT));
@@ -552,6 +585,12 @@ bool PathMoveCopyRec(char* dest, char* orig, u32* flags, bool move, u8* buffer,
             ret = false;
         }
 
+        // space is preallocated, link maps answer the next cluster lookups without FAT reads
+        // (building them walks both chains once, not worth it if we won't copy anyway)
+        if (ret) {
+            fvx_fastseek(&ofile);
+            fvx_fastseek(&dfile);
+        }
         fvx_lseek(&dfile, dsize);
         fvx_sync(&dfile);
         fvx_lseek(&ofile, 0);
@@ -674,7 +713,8 @@ bool PathMoveCopy(const char* dest, const char* orig, u32* flags, bool move) {
         if (flags && (*flags & BUILD_PATH)) fvx_rmkpath(ldest);
 
         // setup buffer
-        u8* buffer = (u8*) malloc(STD_BUFFER_SIZE);
+        u32 bufsiz;
+        u8* buffer = AllocCopyBuffer(&bufsiz);
         if (!buffer) {
             ShowPrompt(false, "%s", STR_OUT_OF_MEMORY);
             return false;
@@ -682,7 +722,7 @@ bool PathMoveCopy(const char* dest, const char* orig, u32* flags, bool move) {
 
         // actual move / copy operation
         bool same_drv = (strncasecmp(lorig, ldest, 2) == 0);
-        bool res = PathMoveCopyRec(ldest, lorig, flags, move && same_drv, buffer, STD_BUFFER_SIZE);
+        bool res = PathMoveCopyRec(ldest, lorig, flags, move && same_drv, buffer, bufsiz);
         if (move && res && (!flags || !(*flags&SKIP_CUR))) PathDelete(lorig);
 
         free(buffer);
@@ -713,7 +753,8 @@ bool PathMoveCopy(const char* dest, const char* orig, u32* flags, bool move) {
         }
 
         // setup buffer
-        u8* buffer = (u8*) malloc(STD_BUFFER_SIZE);
+        u32 bufsiz;
+        u8* buffer = AllocCopyBuffer(&bufsiz);
         if (!buffer) {
             ShowPrompt(false, "%s", STR_OUT_OF_MEMORY);
             return false;
@@ -721,7 +762,7 @@ bool PathMoveCopy(const char* dest, const char* orig, u32* flags, bool move) {
 
         // actual virtual copy operation
         if (force_unmount) DismountDriveType(DriveType(ldest)&(DRV_SYSNAND|DRV_EMUNAND|DRV_IMAGE));
-        bool res = PathMoveCopyRec(ldest, lorig, flags, false, buffer, STD_BUFFER_SIZE);
+        bool res = PathMoveCopyRec(ldest, lorig, flags, false, buffer, bufsiz);
         if (force_unmount) InitExtFS();
 
         free(buffer);
@@ -826,7 +867,7 @@ bool FileSelectorWorker(char* result, const char* text, const char* path, const
 
         while (pos < contents->n_entries) {
             char opt_names[_MAX_FS_OPT+1][UTF_BUFFER_BYTESIZE(32)];
-            DirEntry* res_entry[MAX_DIR_ENTRIES+1] = { NULL };
+            DirEntry* res_entry[_MAX_FS_SCROLL+1] = { NULL };
             u32 n_opt = 0;
             for (; pos < contents->n_entries; pos++) {
                 DirEntry* entry = &(contents->entry[pos]);
@@ -837,7 +878,7 @@ bool FileSelectorWorker(char* result, const char* text, const char* path, const
                 if (!new_style && n_opt == _MAX_FS_OPT) {
                     snprintf(opt_names[n_opt++], 32, "%s", STR_BRACKET_MORE);
                     break;
-                }
+                } else if (new_style && (n_opt == _MAX_FS_SCROLL)) break; // rest goes on the next page
 
                 if (!new_style) {
                     char temp_str[256];
@@ -886,9 +927,11 @@ bool FileSelectorWorker(char* result, const char* text, const char* path, const
 bool FileSelector(char* result, const char* text, const char* path, const char* pattern, u32 flags, bool new_style) {
     void* buffer = (void*) malloc(sizeof(DirStruct));
     if (!buffer) return false;
+    InitDirStruct((DirStruct*) buffer);
 
     // for this to work, result needs to be at least 256 bytes in size
     bool ret = FileSelectorWorker(result, text, path, pattern, flags, buffer, new_style);
+    FreeDirStruct((DirStruct*) buffer);
     free(buffer);
     return ret;
 }
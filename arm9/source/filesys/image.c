@@ -2,39 +2,244 @@
 #include "vff.h"
 #include "nandcmac.h"
 
-static FIL mount_file;
-static u64 mount_state = 0;
+#define IMG_CACHE_BLOCK_SIZE    0x4000 // 16kB
+#define IMG_CACHE_N_BLOCKS      16
+#define IMG_CACHE_READAHEAD     2 // blocks prefetched on sequential misses
 
-static char mount_path[256] = { 0 };
+typedef struct {
+    u64 offset; // image offset of the cached block
+    u32 size; // valid bytes in block, 0 if unused
+    u32 tick; // last use, for LRU eviction
+    bool dirty;
+} ImageCacheSlot;
 
-static bool fix_cmac = false;
+// one entry in the mount table, slot 0 is the image behind the image drives
+typedef struct {
+    FIL file;
+    u64 state; // filetype, 0 if unused
+    char path[256];
+    bool fix_cmac;
+    bool writable;
+    u32 tick; // last use, for LRU eviction of lookup slots
+    u8* cache_buf;
+    ImageCacheSlot cache_slot[IMG_CACHE_N_BLOCKS];
+    u32 cache_tick;
+    u64 cache_next; // next block offset for a sequential read
+    ImageCacheStats cache_stats;
+} ImageMount;
 
+static ImageMount img_mount[IMG_N_SLOTS] = { 0 };
+static u32 img_tick = 0;
 
-int ReadImageBytes(void* buffer, u64 offset, u64 count) {
+
+static int ReadMountBytes(ImageMount* mnt, void* buffer, u64 offset, u64 count) {
     UINT bytes_read;
     UINT ret;
-    if (!count) return -1;
-    if (!mount_state) return FR_INVALID_OBJECT;
-    if (fvx_tell(&mount_file) != offset) {
-        if (fvx_size(&mount_file) < offset) return -1;
-        fvx_lseek(&mount_file, offset);
+    if (fvx_tell(&(mnt->file)) != offset) {
+        if (fvx_size(&(mnt->file)) < offset) return -1;
+        fvx_lseek(&(mnt->file), offset);
     }
-    ret = fvx_read(&mount_file, buffer, count, &bytes_read);
+    ret = fvx_read(&(mnt->file), buffer, count, &bytes_read);
     return (ret != 0) ? (int) ret : (bytes_read != count) ? -1 : 0;
 }
 
-int WriteImageBytes(const void* buffer, u64 offset, u64 count) {
+static int WriteMountBytes(ImageMount* mnt, const void* buffer, u64 offset, u64 count) {
     UINT bytes_written;
     UINT ret;
-    if (!count) return -1;
-    if (!mount_state) return FR_INVALID_OBJECT;
-    if (fvx_tell(&mount_file) != offset)
-        fvx_lseek(&mount_file, offset);
-    ret = fvx_write(&mount_file, buffer, count, &bytes_written);
-    if (ret == 0) fix_cmac = true;
+    if (fvx_tell(&(mnt->file)) != offset)
+        fvx_lseek(&(mnt->file), offset);
+    ret = fvx_write(&(mnt->file), buffer, count, &bytes_written);
+    if (ret == 0) mnt->fix_cmac = true;
     return (ret != 0) ? (int) ret : (bytes_written != count) ? -1 : 0;
 }
 
+static int FlushCacheSlot(ImageMount* mnt, u32 idx) {
+    ImageCacheSlot* slot = &(mnt->cache_slot[idx]);
+    if (!slot->dirty) return 0;
+    int ret = WriteMountBytes(mnt, mnt->cache_buf + (idx * IMG_CACHE_BLOCK_SIZE), slot->offset, slot->size);
+    if (ret == 0) {
+        slot->dirty = false;
+        mnt->cache_stats.writebacks++;
+    }
+    return ret;
+}
+
+static int FlushImageCache(ImageMount* mnt) {
+    int ret = 0;
+    if (!mnt->cache_buf) return 0;
+    for (u32 i = 0; i < IMG_CACHE_N_BLOCKS; i++) {
+        int res = FlushCacheSlot(mnt, i);
+        if (res != 0) ret = res;
+    }
+    return ret;
+}
+
+static void ResetImageCache(ImageMount* mnt) {
+    memset(mnt->cache_slot, 0x00, sizeof(mnt->cache_slot));
+    memset(&(mnt->cache_stats), 0x00, sizeof(ImageCacheStats));
+    mnt->cache_tick = 0;
+    mnt->cache_next = (u64) -1;
+}
+
+// copies the overlapping part between cached blocks and buffer (from cache if to_buffer)
+static void PatchImageCache(ImageMount* mnt, void* buffer, u64 offset, u64 count, bool to_buffer, bool dirty_only) {
+    for (u32 i = 0; i < IMG_CACHE_N_BLOCKS; i++) {
+        ImageCacheSlot* slot = &(mnt->cache_slot[i]);
+        if (!slot->size || (dirty_only && !slot->dirty)) continue;
+        u64 start = max(offset, slot->offset);
+        u64 end = min(offset + count, slot->offset + slot->size);
+        if (start >= end) continue;
+        u8* data = mnt->cache_buf + (i * IMG_CACHE_BLOCK_SIZE) + (start - slot->offset);
+        u8* ext = ((u8*) buffer) + (start - offset);
+        if (to_buffer) memcpy(ext, data, end - start);
+        else memcpy(data, ext, end - start);
+    }
+}
+
+// returns the slot index holding the block at offset, loads it if required (-1 on failure)
+static int GetCacheSlot(ImageMount* mnt, u64 boffset, bool count_stats) {
+    u32 victim = 0;
+    for (u32 i = 0; i < IMG_CACHE_N_BLOCKS; i++) {
+        ImageCacheSlot* slot = &(mnt->cache_slot[i]);
+        if (slot->size && (slot->offset == boffset)) {
+            if (count_stats) mnt->cache_stats.hits++;
+            slot->tick = ++mnt->cache_tick;
+            return i;
+        }
+        if (mnt->cache_slot[victim].size && (!slot->size || (slot->tick < mnt->cache_slot[victim].tick)))
+            victim = i; // unused slots first, then least recently used
+    }
+
+    // cache miss, evict the least recently used block
+    u64 fsize = fvx_size(&(mnt->file));
+    ImageCacheSlot* slot = &(mnt->cache_slot[victim]);
+    if (boffset >= fsize) return -1;
+    if (FlushCacheSlot(mnt, victim) != 0) return -1;
+    slot->size = 0;
+    u32 bsize = min(IMG_CACHE_BLOCK_SIZE, fsize - boffset);
+    if (ReadMountBytes(mnt, mnt->cache_buf + (victim * IMG_CACHE_BLOCK_SIZE), boffset, bsize) != 0)
+        return -1;
+    if (count_stats) mnt->cache_stats.misses++;
+    slot->offset = boffset;
+    slot->size = bsize;
+    slot->tick = ++mnt->cache_tick;
+    return victim;
+}
+
+static int ReadMountCached(ImageMount* mnt, void* buffer, u64 offset, u64 count) {
+    u8* buffer8 = (u8*) buffer;
+    if (!count) return -1;
+    if (!mnt->state) return FR_INVALID_OBJECT;
+
+    // large reads go straight to the file, dirty cached data takes precedence
+    if (!mnt->cache_buf || (count >= IMG_CACHE_BLOCK_SIZE)) {
+        int ret = ReadMountBytes(mnt, buffer, offset, count);
+        if ((ret == 0) && mnt->cache_buf) PatchImageCache(mnt, buffer, offset, count, true, true);
+        return ret;
+    }
+
+    if (offset + count > fvx_size(&(mnt->file))) return -1;
+    while (count) {
+        u64 boffset = offset - (offset % IMG_CACHE_BLOCK_SIZE);
+        u32 misses = mnt->cache_stats.misses;
+        int idx = GetCacheSlot(mnt, boffset, true);
+        if (idx < 0) return -1;
+
+        // sequential miss, prefetch the next blocks
+        if ((mnt->cache_stats.misses != misses) && (boffset == mnt->cache_next)) {
+            for (u32 i = 1; i <= IMG_CACHE_READAHEAD; i++) {
+                u64 poffset = boffset + (i * IMG_CACHE_BLOCK_SIZE);
+                if ((poffset >= fvx_size(&(mnt->file))) || (GetCacheSlot(mnt, poffset, false) < 0)) break;
+                mnt->cache_stats.prefetched++;
+            }
+        }
+        mnt->cache_next = boffset + IMG_CACHE_BLOCK_SIZE;
+
+        u32 pos = offset - boffset;
+        u32 len = min(count, IMG_CACHE_BLOCK_SIZE - pos);
+        memcpy(buffer8, mnt->cache_buf + (idx * IMG_CACHE_BLOCK_SIZE) + pos, len);
+        buffer8 += len;
+        offset += len;
+        count -= len;
+    }
+
+    return 0;
+}
+
+static void CloseMount(ImageMount* mnt) {
+    if (mnt->state) {
+        FlushImageCache(mnt);
+        fvx_close(&(mnt->file));
+        if (mnt->fix_cmac) FixFileCmac(mnt->path, false);
+        mnt->fix_cmac = false;
+        mnt->state = 0;
+        *(mnt->path) = 0;
+    }
+    if (mnt->cache_buf) {
+        free(mnt->cache_buf);
+        mnt->cache_buf = NULL;
+    }
+    ResetImageCache(mnt);
+}
+
+static u64 OpenMount(ImageMount* mnt, const char* path, bool write) {
+    u64 type = (path) ? IdentifyFileType(path) : 0;
+    if (!type) return 0;
+    mnt->writable = write && (fvx_open(&(mnt->file), path, FA_READ | FA_WRITE | FA_OPEN_EXISTING) == FR_OK);
+    if (!mnt->writable && (fvx_open(&(mnt->file), path, FA_READ | FA_OPEN_EXISTING) != FR_OK))
+        return 0;
+    fvx_fastseek(&(mnt->file)); // random access from here on, falls back to normal seek
+    fvx_lseek(&(mnt->file), 0);
+    fvx_sync(&(mnt->file));
+    mnt->cache_buf = (u8*) malloc(IMG_CACHE_N_BLOCKS * IMG_CACHE_BLOCK_SIZE); // no cache if this fails
+    mnt->tick = ++img_tick;
+    strncpy(mnt->path, path, 256);
+    return (mnt->state = type);
+}
+
+int ReadImageBytes(void* buffer, u64 offset, u64 count) {
+    return ReadMountCached(&(img_mount[IMG_SLOT_DRIVE]), buffer, offset, count);
+}
+
+int WriteImageBytes(const void* buffer, u64 offset, u64 count) {
+    ImageMount* mnt = &(img_mount[IMG_SLOT_DRIVE]);
+    const u8* buffer8 = (const u8*) buffer;
+    if (!count) return -1;
+    if (!mnt->state) return FR_INVALID_OBJECT;
+
+    // expanding the image invalidates the partial block at the end
+    if (mnt->cache_buf && (offset + count > fvx_size(&(mnt->file)))) {
+        int ret = FlushImageCache(mnt);
+        if (ret != 0) return ret;
+        memset(mnt->cache_slot, 0x00, sizeof(mnt->cache_slot));
+    }
+
+    // large writes go straight to the file, cached copies are updated
+    if (!mnt->cache_buf || !mnt->writable || (count >= IMG_CACHE_BLOCK_SIZE) || (offset + count > fvx_size(&(mnt->file)))) {
+        int ret = WriteMountBytes(mnt, buffer, offset, count);
+        if ((ret == 0) && mnt->cache_buf) PatchImageCache(mnt, (void*) buffer, offset, count, false, false);
+        return ret;
+    }
+
+    // small writes are held back until the next sync
+    while (count) {
+        u64 boffset = offset - (offset % IMG_CACHE_BLOCK_SIZE);
+        int idx = GetCacheSlot(mnt, boffset, true);
+        if (idx < 0) return -1;
+
+        u32 pos = offset - boffset;
+        u32 len = min(count, IMG_CACHE_BLOCK_SIZE - pos);
+        memcpy(mnt->cache_buf + (idx * IMG_CACHE_BLOCK_SIZE) + pos, buffer8, len);
+        mnt->cache_slot[idx].dirty = true;
+        mnt->fix_cmac = true;
+        buffer8 += len;
+        offset += len;
+        count -= len;
+    }
+
+    return 0;
+}
+
 int ReadImageSectors(void* buffer, u32 sector, u32 count) {
     return ReadImageBytes(buffer, sector * 0x200, count * 0x200);
 }
@@ -44,36 +249,85 @@ int WriteImageSectors(const void* buffer, u32 sector, u32 count) {
 }
 
 int SyncImage(void) {
-    return mount_state ? fvx_sync(&mount_file) : FR_INVALID_OBJECT;
+    ImageMount* mnt = &(img_mount[IMG_SLOT_DRIVE]);
+    if (!mnt->state) return FR_INVALID_OBJECT;
+    int ret = FlushImageCache(mnt);
+    return (ret != 0) ? ret : (int) fvx_sync(&(mnt->file));
+}
+
+void GetImageCacheStats(ImageCacheStats* stats) {
+    memcpy(stats, &(img_mount[IMG_SLOT_DRIVE].cache_stats), sizeof(ImageCacheStats));
 }
 
 u64 GetMountSize(void) {
-    return mount_state ? fvx_size(&mount_file) : 0;
+    return GetImageSlotSize(IMG_SLOT_DRIVE);
 }
 
 u64 GetMountState(void) {
-    return mount_state;
+    return GetImageSlotState(IMG_SLOT_DRIVE);
 }
 
 const char* GetMountPath(void) {
-    return mount_path;
+    return img_mount[IMG_SLOT_DRIVE].path;
 }
 
 u64 MountImage(const char* path) {
-    if (mount_state) {
-        fvx_close(&mount_file);
-        if (fix_cmac) FixFileCmac(mount_path, false);
-        fix_cmac = false;
-        mount_state = 0;
-        *mount_path = 0;
+    ImageMount* mnt = &(img_mount[IMG_SLOT_DRIVE]);
+    CloseMount(mnt);
+    if (path) CloseImageSlots(path); // lookup slots would keep the file locked
+    return OpenMount(mnt, path, true);
+}
+
+int OpenImageSlot(const char* path) {
+    int slot = -1;
+
+    // already open? (this includes the drive image)
+    for (u32 i = 0; i < IMG_N_SLOTS; i++) {
+        ImageMount* mnt = &(img_mount[i]);
+        if (mnt->state && (strncasecmp(mnt->path, path, 256) == 0)) {
+            mnt->tick = ++img_tick;
+            return i;
+        }
     }
-    u64 type = (path) ? IdentifyFileType(path) : 0;
-    if (!type) return 0;
-    if ((fvx_open(&mount_file, path, FA_READ | FA_WRITE | FA_OPEN_EXISTING) != FR_OK) &&
-        (fvx_open(&mount_file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK))
-        return 0;
-    fvx_lseek(&mount_file, 0);
-    fvx_sync(&mount_file);
-    strncpy(mount_path, path, 256);
-    return (mount_state = type);
+
+    // find a free lookup slot, otherwise replace the least recently used one
+    for (u32 i = IMG_SLOT_DRIVE + 1; i < IMG_N_SLOTS; i++) {
+        if (!img_mount[i].state) {
+            slot = i;
+            break;
+        }
+        if ((slot < 0) || (img_mount[i].tick < img_mount[slot].tick))
+            slot = i;
+    }
+
+    CloseMount(&(img_mount[slot]));
+    return OpenMount(&(img_mount[slot]), path, false) ? slot : -1;
+}
+
+void CloseImageSlots(const char* path) {
+    for (u32 i = IMG_SLOT_DRIVE + 1; i < IMG_N_SLOTS; i++) {
+        ImageMount* mnt = &(img_mount[i]);
+        if (mnt->state && path && (strncasecmp(mnt->path, path, 256) != 0)) continue;
+        CloseMount(mnt);
+    }
+}
+
+int ReadImageSlotBytes(int slot, void* buffer, u64 offset, u64 count) {
+    if ((slot < 0) || (slot >= IMG_N_SLOTS)) return FR_INVALID_OBJECT;
+    return ReadMountCached(&(img_mount[slot]), buffer, offset, count);
+}
+
+u64 GetImageSlotSize(int slot) {
+    if ((slot < 0) || (slot >= IMG_N_SLOTS)) return 0;
+    return img_mount[slot].state ? fvx_size(&(img_mount[slot].file)) : 0;
+}
+
+u64 GetImageSlotState(int slot) {
+    if ((slot < 0) || (slot >= IMG_N_SLOTS)) return 0;
+    return img_mount[slot].state;
+}
+
+const char* GetImageSlotPath(int slot) {
+    if ((slot < 0) || (slot >= IMG_N_SLOTS)) return "";
+    return img_mount[slot].path;
 }
@@ -3,13 +3,33 @@
 #include "common.h"
 #include "filetype.h"
 
+// mount table, the drive image is what the image drives are built from,
+// the other slots hold images opened read-only for lookups
+#define IMG_N_SLOTS     4
+#define IMG_SLOT_DRIVE  0
+
+typedef struct {
+    u32 hits;
+    u32 misses;
+    u32 prefetched;
+    u32 writebacks;
+} ImageCacheStats;
+
 int ReadImageBytes(void* buffer, u64 offset, u64 count);
 int WriteImageBytes(const void* buffer, u64 offset, u64 count);
 int ReadImageSectors(void* buffer, u32 sector, u32 count);
 int WriteImageSectors(const void* buffer, u32 sector, u32 count);
 int SyncImage(void);
+void GetImageCacheStats(ImageCacheStats* stats);
 
 u64 GetMountSize(void);
 u64 GetMountState(void);
 const char* GetMountPath(void);
 u64 MountImage(const char* path);
+
+int OpenImageSlot(const char* path);
+void CloseImageSlots(const char* path);
+int ReadImageSlotBytes(int slot, void* buffer, u64 offset, u64 count);
+u64 GetImageSlotSize(int slot);
+u64 GetImageSlotState(int slot);
+const char* GetImageSlotPath(int slot);
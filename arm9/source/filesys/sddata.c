@@ -219,6 +219,12 @@ FRESULT fx_write (FIL* fp, const void* buff, UINT btw, UINT* bw) {
 FRESULT fx_close (FIL* fp) {
     FilCryptInfo* info = fx_find_cryptinfo(fp);
     if (info) memset(info, 0, sizeof(FilCryptInfo));
+    #if FF_USE_FASTSEEK
+    if (fp->cltbl) { // link map from fvx_fastseek()
+        free(fp->cltbl);
+        fp->cltbl = NULL;
+    }
+    #endif
     return f_close(fp);
 }
 
@@ -31,6 +31,32 @@ bool CheckSupportFile(const char* fname, size_t* fsize)
     return false;
 }
 
+u64 GetFileStamp(const char* path)
+{
+    FILINFO fno;
+    if (fvx_stat(path, &fno) != FR_OK) return 0;
+    return (((u64) fno.fsize) << 32) | (((u64) fno.fdate) << 16) | fno.ftime;
+}
+
+u64 GetSupportFileStamp(const char* fname)
+{
+    // try VRAM0 first (this never changes)
+    u64 tar_fsize;
+    void* data = FindVTarFileInfo(fname, &tar_fsize);
+    if (data) return (tar_fsize << 32) | (u32) (uintptr_t) data;
+
+    // same search order as LoadSupportFile()
+    const char* base_paths[] = { SUPPORT_FILE_PATHS };
+    for (u32 i = 0; i < countof(base_paths); i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", base_paths[i], fname);
+        u64 stamp = GetFileStamp(path);
+        if (stamp) return stamp ^ i;
+    }
+
+    return 0;
+}
+
 size_t LoadSupportFile(const char* fname, void* buffer, size_t max_len)
 {
     // try VRAM0 first
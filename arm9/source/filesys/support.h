@@ -9,6 +9,8 @@
 #define PAYLOADS_DIR    "payloads"
 
 bool CheckSupportFile(const char* fname, size_t* fsize);
+u64 GetFileStamp(const char* path); // changes when the file is modified, 0 if not found
+u64 GetSupportFileStamp(const char* fname);
 size_t LoadSupportFile(const char* fname, void* buffer, size_t max_len);
 bool SaveSupportFile(const char* fname, void* buffer, size_t len);
 bool SetAsSupportFile(const char* fname, const char* source);
@@ -1,6 +1,7 @@
 #include "virtual.h"
 #include "ffconf.h"
 #include "vff.h"
+#include "image.h"
 
 #if FF_USE_LFN != 0
 #define _MAX_FN_LEN (FF_MAX_LFN)
@@ -14,7 +15,24 @@
 #define VFIL(fp) ((VirtualFile*) (void*) fp->buf)
 #define VDIR(dp) ((VirtualDir*) (void*) &(dp->dptr))
 
+// cluster link map table (CLMT) sizes, in DWORDs (2 per fragment + 2)
+#define CLMT_INIT_SIZE  (64)
+#define CLMT_MAX_SIZE   (64 * 1024 / sizeof(DWORD)) // memory budget per file
+
+static void fvx_dropfastseek (FIL* fp) {
+    #if FF_USE_FASTSEEK
+    if (fp->cltbl) {
+        free(fp->cltbl);
+        fp->cltbl = NULL;
+    }
+    #else
+    (void) fp;
+    #endif
+}
+
 FRESULT fvx_open (FIL* fp, const TCHAR* path, BYTE mode) {
+    if (mode & (FA_WRITE|FA_CREATE_NEW|FA_CREATE_ALWAYS|FA_OPEN_ALWAYS))
+        InvalidateFileTypeCache();
     #if _VFIL_ENABLED
     VirtualFile* vfile = VFIL(fp);
     memset(fp, 0, sizeof(FIL));
@@ -25,7 +43,12 @@ FRESULT fvx_open (FIL* fp, const TCHAR* path, BYTE mode) {
         return FR_OK;
     }
     #endif
-    return fx_open ( fp, path, mode );
+    FRESULT res = fx_open ( fp, path, mode );
+    if (res == FR_LOCKED) { // may be held open by a lookup image, these give way
+        CloseImageSlots(NULL);
+        res = fx_open ( fp, path, mode );
+    }
+    return res;
 }
 
 FRESULT fvx_read (FIL* fp, void* buff, UINT btr, UINT* br) {
@@ -41,6 +64,7 @@ FRESULT fvx_read (FIL* fp, void* buff, UINT btr, UINT* br) {
 }
 
 FRESULT fvx_write (FIL* fp, const void* buff, UINT btw, UINT* bw) {
+    InvalidateFileTypeCache();
     #if _VFIL_ENABLED
     if (fp->obj.fs == NULL) {
         VirtualFile* vfile = VFIL(fp);
@@ -49,14 +73,16 @@ FRESULT fvx_write (FIL* fp, const void* buff, UINT btw, UINT* bw) {
         return res;
     }
     #endif
+    // fast seek mode can't expand files, fall back to normal mode
+    if (fp->fptr + btw > fvx_size(fp)) fvx_dropfastseek(fp);
     return fx_write ( fp, buff, btw, bw );
 }
 
 FRESULT fvx_close (FIL* fp) {
     #if _VFIL_ENABLED
-    if (fp->obj.fs == NULL) return FR_OK;
+    if (fp->obj.fs == NULL) return fvx_sync( fp );
     #endif
-    return fx_close( fp );
+    return fx_close( fp ); // this also frees the link map
 }
 
 FRESULT fvx_lseek (FIL* fp, FSIZE_t ofs) {
@@ -68,12 +94,46 @@ FRESULT fvx_lseek (FIL* fp, FSIZE_t ofs) {
         } else return FR_DENIED;
     }
     #endif
+    // fast seek mode clips at the file size, but seeking past end expands the file
+    if (ofs > fvx_size(fp)) fvx_dropfastseek(fp);
     return f_lseek( fp, ofs );
 }
 
+FRESULT fvx_fastseek (FIL* fp) {
+    #if FF_USE_FASTSEEK
+    FRESULT res;
+    #if _VFIL_ENABLED
+    if (fp->obj.fs == NULL) return FR_OK; // virtual files don't need this
+    #endif
+    if (fp->cltbl) return FR_OK; // already enabled
+
+    // build the CLMT, grow it to the required size if initial size is not enough
+    FSIZE_t fptr = fvx_tell(fp);
+    for (DWORD tlen = CLMT_INIT_SIZE; tlen <= CLMT_MAX_SIZE;) {
+        fp->cltbl = (DWORD*) malloc(tlen * sizeof(DWORD));
+        if (!fp->cltbl) return FR_NOT_ENOUGH_CORE;
+        fp->cltbl[0] = tlen;
+        res = f_lseek(fp, CREATE_LINKMAP);
+        if (res == FR_OK) return f_lseek(fp, fptr); // seek via CLMT resyncs the file object
+        tlen = fp->cltbl[0]; // required size
+        fvx_dropfastseek(fp);
+        if (res != FR_NOT_ENOUGH_CORE) return res;
+    }
+
+    // too fragmented, file stays in normal seek mode
+    return FR_NOT_ENOUGH_CORE;
+    #else
+    (void) fp;
+    return FR_OK;
+    #endif
+}
+
 FRESULT fvx_sync (FIL* fp) {
     #if _VFIL_ENABLED
-    if (fp->obj.fs == NULL) return FR_OK;
+    if (fp->obj.fs == NULL) { // virtual files may sit on the mounted image
+        if (GetMountState()) SyncImage();
+        return FR_OK;
+    }
     #endif
     return f_sync( fp );
 }
@@ -96,16 +156,29 @@ FRESULT fvx_stat (const TCHAR* path, FILINFO* fno) {
 
 FRESULT fvx_rename (const TCHAR* path_old, const TCHAR* path_new) {
     if ((GetVirtualSource(path_old)) || CheckAliasDrive(path_old)) return FR_DENIED;
-    return f_rename( path_old, path_new );
+    InvalidateFileTypeCache();
+    FRESULT res = f_rename( path_old, path_new );
+    if (res == FR_LOCKED) { // see fvx_open()
+        CloseImageSlots(NULL);
+        res = f_rename( path_old, path_new );
+    }
+    return res;
 }
 
 FRESULT fvx_unlink (const TCHAR* path) {
+    InvalidateFileTypeCache();
     if (GetVirtualSource(path)) {
         VirtualFile vfile;
         if (!GetVirtualFile(&vfile, path, FA_READ)) return FR_NO_PATH;
         if (DeleteVirtualFile(&vfile) != 0) return FR_DENIED;
         return FR_OK;
-    } else return fa_unlink( path );
+    }
+    FRESULT res = fa_unlink( path );
+    if (res == FR_LOCKED) { // see fvx_open()
+        CloseImageSlots(NULL);
+        res = fa_unlink( path );
+    }
+    return res;
 }
 
 FRESULT fvx_mkdir (const TCHAR* path) {
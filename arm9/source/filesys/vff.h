@@ -30,6 +30,11 @@ FRESULT fvx_opendir (DIR* dp, const TCHAR* path);
 FRESULT fvx_closedir (DIR* dp);
 FRESULT fvx_readdir (DIR* dp, FILINFO* fno);
 
+// additional fast seek function (cluster link map, O(1) seeks within the file)
+// building the map walks the whole cluster chain, the map is freed in fvx_close() / fx_close()
+// (never use f_close() on files opened via fvx_open())
+FRESULT fvx_fastseek (FIL* fp);
+
 // additional quick read / write / create functions
 FRESULT fvx_qread (const TCHAR* path, void* buff, FSIZE_t ofs, UINT btr, UINT* br);
 FRESULT fvx_qwrite (const TCHAR* path, const void* buff, FSIZE_t ofs, UINT btw, UINT* bw);
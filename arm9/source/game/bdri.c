@@ -2,9 +2,12 @@
 #include "fsperm.h"
 #include "ifat_common.h"
 #include "bdri.h"
+#include "disadiff.h"
+#include "ticketdb.h"
 #include "image.h"
 #include "language.h"
 #include "nandcmac.h"
+#include "sha.h"
 #include "ui.h"
 #include "vff.h"
 
@@ -83,9 +86,13 @@ typedef struct {
 } __attribute__((packed, aligned(4))) TicketEntry;
 
 static FIL* bdrifp;
+static int bdrislot = -1; // lookup image slot, partition A is read directly from there
+static DisaDiffRWInfo bdriinfo;
 
 static FRESULT BDRIRead(UINT ofs, UINT btr, void* buf) {
-    if (bdrifp) {
+    if (bdrislot >= 0) {
+        return (ReadDisaDiffIvfcLvl4Slot(bdrislot, &bdriinfo, ofs, btr, buf) == btr) ? FR_OK : FR_DENIED;
+    } else if (bdrifp) {
         FRESULT res;
         UINT br;
         if ((fvx_tell(bdrifp) != ofs) &&
@@ -108,6 +115,43 @@ static FRESULT BDRIWrite(UINT ofs, UINT btw, const void* buf) {
     } else return FR_DENIED;
 }
 
+// opens a database for reading, .db files are read through a lookup image slot instead of mounting them
+static u32 BDRIOpenRead(FIL* file, const char* path) {
+    bdrifp = NULL;
+    bdrislot = -1;
+
+    if (IdentifyFileType(path) & SYS_DIFF) {
+        int slot = OpenImageSlot(path);
+        u8* cache = NULL;
+        if ((slot < 0) || (GetDisaDiffRWInfoSlot(slot, &bdriinfo, false) != 0) ||
+            !(cache = (u8*) malloc(bdriinfo.size_dpfs_lvl2)) ||
+            (BuildDisaDiffDpfsLvl2CacheSlot(slot, &bdriinfo, cache, bdriinfo.size_dpfs_lvl2) != 0)) {
+            if (cache) free(cache);
+            return 1;
+        }
+        bdriinfo.dpfs_lvl2_cache = cache;
+        bdrislot = slot;
+        return 0;
+    }
+
+    if (fvx_open(file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+        return 1;
+    bdrifp = file;
+    return 0;
+}
+
+static void BDRICloseRead(void) {
+    if (bdrislot >= 0) {
+        free(bdriinfo.dpfs_lvl2_cache);
+        bdriinfo.dpfs_lvl2_cache = NULL;
+        bdrislot = -1;
+    }
+    if (bdrifp) {
+        fvx_close(bdrifp);
+        bdrifp = NULL;
+    }
+}
+
 bool CheckDBMagic(const u8* pre_header, bool tickdb) {
     const TitleDBHeader* title = (TitleDBHeader*) (void *) pre_header;
     const TickDBHeader* tick = (TickDBHeader*) (void *) pre_header;
@@ -166,45 +210,15 @@ static u32 GetBDRIEntrySize(const BDRIFsHeader* fs_header, const u32 fs_header_o
     return 0;
 }
 
-static u32 ReadBDRIEntry(const BDRIFsHeader* fs_header, const u32 fs_header_offset, const u8* title_id, u8* entry, const u32 expected_size) {
-    if ((fs_header->pre_header.fs_info_offset != 0x20) ||
-        (fs_header->fs_info.fat.outfat_count != fs_header->fs_info.data_region.outfat_count)) // Could be more thorough
-        return 1;
-
+static u32 ReadBDRIEntryBlocks(const BDRIFsHeader* fs_header, const u32 fs_header_offset, const BDRIFileEntry* file_entry, u8* entry) {
     const u32 data_offset = fs_header_offset + fs_header->fs_info.data_region.outfat_offset;
-    const u32 fet_offset = data_offset + fs_header->fs_info.filetable_info.starting_block_index * fs_header->fs_info.data_region_blocksize;
-    const u32 fht_offset = fs_header_offset + fs_header->fs_info.file_hashtbl.outfat_offset;
     const u32 fat_offset = fs_header_offset + fs_header->fs_info.fat.outfat_offset;
 
-    u32 index = 0;
-    BDRIFileEntry file_entry;
-    u64 tid_be = getbe64(title_id);
-    u8* title_id_be = (u8*) &tid_be;
-    const u32 hash_bucket = GetHashBucket(title_id_be, 1, fs_header->fs_info.file_hashtbl.outfat_count);
-
-    if (BDRIRead(fht_offset + hash_bucket * sizeof(u32), sizeof(u32), &(file_entry.hash_bucket_next_index)) != FR_OK)
-        return 1;
-
-    // Find the file entry for the tid specified, fail if it doesn't exist
-    do {
-        if (file_entry.hash_bucket_next_index == 0)
-            return 1;
-
-        index = file_entry.hash_bucket_next_index;
-
-        if (BDRIRead(fet_offset + index * sizeof(BDRIFileEntry), sizeof(BDRIFileEntry), &file_entry) != FR_OK)
-            return 1;
-    } while (memcmp(title_id_be, file_entry.title_id, 8) != 0);
-
-    if (expected_size && (file_entry.size != expected_size))
-        return 1;
-
-    index = file_entry.start_block_index + 1; // FAT entry index
-
+    u32 index = file_entry->start_block_index + 1; // FAT entry index
     u32 bytes_read = 0;
     u32 fat_entry[2];
 
-    while (bytes_read < file_entry.size) { // Read the full entry, walking the FAT node chain
+    while (bytes_read < file_entry->size) { // Read the full entry, walking the FAT node chain
         u32 read_start = index - 1; // Data region block index
         u32 read_count = 0;
 
@@ -230,7 +244,7 @@ static u32 ReadBDRIEntry(const BDRIFsHeader* fs_header, const u32 fs_header_offs
 
         index = next_index;
 
-        u32 btr = min(file_entry.size - bytes_read, read_count * fs_header->fs_info.data_region_blocksize);
+        u32 btr = min(file_entry->size - bytes_read, read_count * fs_header->fs_info.data_region_blocksize);
         if (entry && (BDRIRead(data_offset + read_start * fs_header->fs_info.data_region_blocksize, btr, entry + bytes_read) != FR_OK))
             return 1;
 
@@ -240,6 +254,41 @@ static u32 ReadBDRIEntry(const BDRIFsHeader* fs_header, const u32 fs_header_offs
     return 0;
 }
 
+static u32 ReadBDRIEntry(const BDRIFsHeader* fs_header, const u32 fs_header_offset, const u8* title_id, u8* entry, const u32 expected_size) {
+    if ((fs_header->pre_header.fs_info_offset != 0x20) ||
+        (fs_header->fs_info.fat.outfat_count != fs_header->fs_info.data_region.outfat_count)) // Could be more thorough
+        return 1;
+
+    const u32 data_offset = fs_header_offset + fs_header->fs_info.data_region.outfat_offset;
+    const u32 fet_offset = data_offset + fs_header->fs_info.filetable_info.starting_block_index * fs_header->fs_info.data_region_blocksize;
+    const u32 fht_offset = fs_header_offset + fs_header->fs_info.file_hashtbl.outfat_offset;
+
+    u32 index = 0;
+    BDRIFileEntry file_entry;
+    u64 tid_be = getbe64(title_id);
+    u8* title_id_be = (u8*) &tid_be;
+    const u32 hash_bucket = GetHashBucket(title_id_be, 1, fs_header->fs_info.file_hashtbl.outfat_count);
+
+    if (BDRIRead(fht_offset + hash_bucket * sizeof(u32), sizeof(u32), &(file_entry.hash_bucket_next_index)) != FR_OK)
+        return 1;
+
+    // Find the file entry for the tid specified, fail if it doesn't exist
+    do {
+        if (file_entry.hash_bucket_next_index == 0)
+            return 1;
+
+        index = file_entry.hash_bucket_next_index;
+
+        if (BDRIRead(fet_offset + index * sizeof(BDRIFileEntry), sizeof(BDRIFileEntry), &file_entry) != FR_OK)
+            return 1;
+    } while (memcmp(title_id_be, file_entry.title_id, 8) != 0);
+
+    if (expected_size && (file_entry.size != expected_size))
+        return 1;
+
+    return ReadBDRIEntryBlocks(fs_header, fs_header_offset, &file_entry, entry);
+}
+
 static u32 RemoveBDRIEntry(const BDRIFsHeader* fs_header, const u32 fs_header_offset, const u8* title_id) {
     if ((fs_header->pre_header.fs_info_offset != 0x20) ||
         (fs_header->fs_info.fat.outfat_count != fs_header->fs_info.data_region.outfat_count)) // Could be more thorough
@@ -600,6 +649,28 @@ static u32 AddBDRIEntry(const BDRIFsHeader* fs_header, const u32 fs_header_offse
     return 0;
 }
 
+static u32 AddBDRITicket(const BDRIFsHeader* fs_header, const u32 fs_header_offset, const u8* title_id, const Ticket* ticket, bool replace) {
+    u32 entry_size = sizeof(TicketEntry) + GetTicketContentIndexSize(ticket);
+    u32 ret;
+
+    TicketEntry* te = (TicketEntry*)malloc(entry_size);
+    if (!te) {
+        return 1;
+    }
+
+    te->ticket_count = 1;
+    te->ticket_size = GetTicketSize(ticket);
+    memcpy(&te->ticket, ticket, te->ticket_size);
+
+    ret = AddBDRIEntry(fs_header, fs_header_offset, title_id, (const u8*) te, entry_size, replace);
+    if (ret == REPLACE_SIZE_MISMATCH)
+        ret = ((RemoveBDRIEntry(fs_header, fs_header_offset, title_id) != 0) ||
+            (AddBDRIEntry(fs_header, fs_header_offset, title_id, (const u8*) te, entry_size, replace) != 0)) ? 1 : 0;
+
+    free(te);
+    return ret;
+}
+
 static u32 GetNumBDRIEntries(const BDRIFsHeader* fs_header, const u32 fs_header_offset) {
     if ((fs_header->pre_header.fs_info_offset != 0x20) ||
         (fs_header->fs_info.fat.outfat_count != fs_header->fs_info.data_region.outfat_count)) // Could be more thorough
@@ -657,26 +728,103 @@ static u32 ListBDRIEntryTitleIDs(const BDRIFsHeader* fs_header, const u32 fs_hea
     return 0;
 }
 
+static int compBDRIFileEntryBlock(const void* e1, const void* e2) {
+    const BDRIFileEntry* entry1 = (const BDRIFileEntry*) e1;
+    const BDRIFileEntry* entry2 = (const BDRIFileEntry*) e2;
+    return (entry1->start_block_index < entry2->start_block_index) ? -1 :
+        (entry1->start_block_index > entry2->start_block_index) ? 1 : 0;
+}
+
+static u32 ListBDRITicketIndex(const BDRIFsHeader* fs_header, const u32 fs_header_offset, TicketIndexEntry* index, u32 max_entries, u32* n_entries,
+    TicketSigCheck sig_check) {
+    if ((fs_header->pre_header.fs_info_offset != 0x20) ||
+        (fs_header->fs_info.fat.outfat_count != fs_header->fs_info.data_region.outfat_count))
+        return 1;
+
+    const u32 data_offset = fs_header_offset + fs_header->fs_info.data_region.outfat_offset;
+    const u32 det_offset = data_offset + fs_header->fs_info.dirtable_info.starting_block_index * fs_header->fs_info.data_region_blocksize;
+    const u32 fet_offset = data_offset + fs_header->fs_info.filetable_info.starting_block_index * fs_header->fs_info.data_region_blocksize;
+
+    BDRIFileEntry* file_entries = (BDRIFileEntry*) malloc(max_entries * sizeof(BDRIFileEntry));
+    if (!file_entries) return 1;
+
+    // Collect all file entries, then read the tickets in data region order
+    u32 num_entries = 0;
+    BDRIFileEntry file_entry;
+    if (BDRIRead(det_offset + 0x2C, sizeof(u32), &(file_entry.next_sibling_index)) != FR_OK) {
+        free(file_entries);
+        return 1;
+    }
+
+    while ((file_entry.next_sibling_index != 0) && (num_entries < max_entries)) {
+        if (BDRIRead(fet_offset + file_entry.next_sibling_index * sizeof(BDRIFileEntry), sizeof(BDRIFileEntry), &file_entry) != FR_OK) {
+            free(file_entries);
+            return 1;
+        }
+        memcpy(file_entries + num_entries++, &file_entry, sizeof(BDRIFileEntry));
+    }
+
+    qsort(file_entries, num_entries, sizeof(BDRIFileEntry), compBDRIFileEntryBlock);
+
+    // malformed tickets are left out of the index, these don't affect the others
+    TicketEntry* te = NULL;
+    u32 te_alloc = 0;
+    u32 n_index = 0;
+    u32 ret = 0;
+    for (u32 i = 0; i < num_entries; i++) {
+        BDRIFileEntry* fe = file_entries + i;
+        if (fe->size < sizeof(TicketEntry) + 0x14)
+            continue;
+
+        if (fe->size > te_alloc) {
+            TicketEntry* te_new = (TicketEntry*) realloc(te, fe->size);
+            if (!te_new) {
+                ret = 1;
+                break;
+            }
+            te = te_new;
+            te_alloc = fe->size;
+        }
+
+        if ((ReadBDRIEntryBlocks(fs_header, fs_header_offset, fe, (u8*) te) != 0) ||
+            (te->ticket_size != GetTicketSize(&te->ticket)) ||
+            (te->ticket_size > fe->size - (sizeof(TicketEntry) - sizeof(Ticket))))
+            continue;
+
+        TicketIndexEntry* entry = index + n_index++;
+        u64 tid_be = getbe64(fe->title_id);
+        memset(entry, 0x00, sizeof(TicketIndexEntry));
+        memcpy(entry->title_id, (u8*) &tid_be, 8);
+        memcpy(entry->console_id, te->ticket.console_id, 4);
+        entry->commonkey_idx = te->ticket.commonkey_idx;
+        memcpy(entry->titlekey, te->ticket.titlekey, 16);
+        entry->size = te->ticket_size;
+        sha_quick(entry->ticket_sha256, &(te->ticket), te->ticket_size, SHA256_MODE);
+        if (sig_check) entry->sig_valid = (sig_check(&(te->ticket), entry->ticket_sha256) == 0) ? 1 : 0;
+    }
+
+    free(te);
+    free(file_entries);
+    if (ret == 0) *n_entries = n_index;
+    return ret;
+}
+
 u32 GetNumTitleInfoEntries(const char* path) {
     FIL file;
     TitleDBHeader pre_header;
 
-    if (fvx_open(&file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    if (BDRIOpenRead(&file, path) != 0)
         return 0;
 
-    bdrifp = &file;
-
     if ((BDRIRead(0, sizeof(TitleDBHeader), &pre_header) != FR_OK) ||
         !CheckDBMagic((u8*) &pre_header, false)) {
-        fvx_close(bdrifp);
-        bdrifp = NULL;
+        BDRICloseRead();
         return 0;
     }
 
     u32 num = GetNumBDRIEntries(&(pre_header.fs_header), sizeof(TitleDBHeader) - sizeof(BDRIFsHeader));
 
-    fvx_close(bdrifp);
-    bdrifp = NULL;
+    BDRICloseRead();
     return num;
 }
 
@@ -684,22 +832,18 @@ u32 GetNumTickets(const char* path) {
     FIL file;
     TickDBHeader pre_header;
 
-    if (fvx_open(&file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    if (BDRIOpenRead(&file, path) != 0)
         return 0;
 
-    bdrifp = &file;
-
     if ((BDRIRead(0, sizeof(TickDBHeader), &pre_header) != FR_OK) ||
         !CheckDBMagic((u8*) &pre_header, true)) {
-        fvx_close(bdrifp);
-        bdrifp = NULL;
+        BDRICloseRead();
         return 0;
     }
 
     u32 num = GetNumBDRIEntries(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader));
 
-    fvx_close(bdrifp);
-    bdrifp = NULL;
+    BDRICloseRead();
     return num;
 }
 
@@ -707,21 +851,17 @@ u32 ListTitleInfoEntryTitleIDs(const char* path, u8* title_ids, u32 max_title_id
     FIL file;
     TitleDBHeader pre_header;
 
-    if (fvx_open(&file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    if (BDRIOpenRead(&file, path) != 0)
         return 1;
 
-    bdrifp = &file;
-
     if ((BDRIRead(0, sizeof(TitleDBHeader), &pre_header) != FR_OK) ||
         !CheckDBMagic((u8*) &pre_header, false) ||
         (ListBDRIEntryTitleIDs(&(pre_header.fs_header), sizeof(TitleDBHeader) - sizeof(BDRIFsHeader), title_ids, max_title_ids) != 0)) {
-        fvx_close(bdrifp);
-        bdrifp = NULL;
+        BDRICloseRead();
         return 1;
     }
 
-    fvx_close(bdrifp);
-    bdrifp = NULL;
+    BDRICloseRead();
     return 0;
 }
 
@@ -729,21 +869,36 @@ u32 ListTicketTitleIDs(const char* path, u8* title_ids, u32 max_title_ids) {
     FIL file;
     TickDBHeader pre_header;
 
-    if (fvx_open(&file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    if (BDRIOpenRead(&file, path) != 0)
         return 1;
 
-    bdrifp = &file;
-
     if ((BDRIRead(0, sizeof(TickDBHeader), &pre_header) != FR_OK) ||
         !CheckDBMagic((u8*) &pre_header, true) ||
         (ListBDRIEntryTitleIDs(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), title_ids, max_title_ids) != 0)) {
-        fvx_close(bdrifp);
-        bdrifp = NULL;
+        BDRICloseRead();
         return 1;
     }
 
-    fvx_close(bdrifp);
-    bdrifp = NULL;
+    BDRICloseRead();
+    return 0;
+}
+
+// builds a ticket index in one pass, entries are not in title id order
+u32 ListTicketIndex(const char* path, TicketIndexEntry* index, u32 max_entries, u32* n_entries, TicketSigCheck sig_check) {
+    FIL file;
+    TickDBHeader pre_header;
+
+    if (BDRIOpenRead(&file, path) != 0)
+        return 1;
+
+    if ((BDRIRead(0, sizeof(TickDBHeader), &pre_header) != FR_OK) ||
+        !CheckDBMagic((u8*) &pre_header, true) ||
+        (ListBDRITicketIndex(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), index, max_entries, n_entries, sig_check) != 0)) {
+        BDRICloseRead();
+        return 1;
+    }
+
+    BDRICloseRead();
     return 0;
 }
 
@@ -751,22 +906,18 @@ u32 ReadTitleInfoEntryFromDB(const char* path, const u8* title_id, TitleInfoEntr
     FIL file;
     TitleDBHeader pre_header;
 
-    if (fvx_open(&file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    if (BDRIOpenRead(&file, path) != 0)
         return 1;
 
-    bdrifp = &file;
-
     if ((BDRIRead(0, sizeof(TitleDBHeader), &pre_header) != FR_OK) ||
         !CheckDBMagic((u8*) &pre_header, false) ||
         (ReadBDRIEntry(&(pre_header.fs_header), sizeof(TitleDBHeader) - sizeof(BDRIFsHeader), title_id, (u8*) tie,
             sizeof(TitleInfoEntry)) != 0)) {
-        fvx_close(bdrifp);
-        bdrifp = NULL;
+        BDRICloseRead();
         return 1;
     }
 
-    fvx_close(bdrifp);
-    bdrifp = NULL;
+    BDRICloseRead();
     return 0;
 }
 
@@ -777,11 +928,9 @@ u32 ReadTicketFromDB(const char* path, const u8* title_id, Ticket** ticket) {
     u32 entry_size;
 
     *ticket = NULL;
-    if (fvx_open(&file, path, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    if (BDRIOpenRead(&file, path) != 0)
         return 1;
 
-    bdrifp = &file;
-
     if ((BDRIRead(0, sizeof(TickDBHeader), &pre_header) != FR_OK) ||
         !CheckDBMagic((u8*) &pre_header, true) ||
         (GetBDRIEntrySize(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), title_id, &entry_size) != 0) ||
@@ -790,13 +939,11 @@ u32 ReadTicketFromDB(const char* path, const u8* title_id, Ticket** ticket) {
         (ReadBDRIEntry(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), title_id, (u8*) te,
             entry_size) != 0)) {
         free(te); // if allocated
-        fvx_close(bdrifp);
-        bdrifp = NULL;
+        BDRICloseRead();
         return 1;
     }
 
-    fvx_close(bdrifp);
-    bdrifp = NULL;
+    BDRICloseRead();
 
     if (te->ticket_size != GetTicketSize(&te->ticket)) {
         free(te);
@@ -842,6 +989,8 @@ u32 RemoveTicketFromDB(const char* path, const u8* title_id) {
     FIL file;
     TickDBHeader pre_header;
 
+    InvalidateTitleKeyIndex();
+
     if (fvx_open(&file, path, FA_READ | FA_WRITE | FA_OPEN_EXISTING) != FR_OK)
         return 1;
 
@@ -886,44 +1035,78 @@ u32 AddTitleInfoEntryToDB(const char* path, const u8* title_id, const TitleInfoE
 u32 AddTicketToDB(const char* path, const u8* title_id, const Ticket* ticket, bool replace) {
     FIL file;
     TickDBHeader pre_header;
-    u32 entry_size = sizeof(TicketEntry) + GetTicketContentIndexSize(ticket);
 
-    TicketEntry* te = (TicketEntry*)malloc(entry_size);
-    if (!te) {
-        return 1;
-    }
+    InvalidateTitleKeyIndex();
 
-    te->ticket_count = 1;
-    te->ticket_size = GetTicketSize(ticket);
-    memcpy(&te->ticket, ticket, te->ticket_size);
-    if (fvx_open(&file, path, FA_READ | FA_WRITE | FA_OPEN_EXISTING) != FR_OK) {
-        free(te);
+    if (fvx_open(&file, path, FA_READ | FA_WRITE | FA_OPEN_EXISTING) != FR_OK)
         return 1;
-    }
 
     bdrifp = &file;
 
-    u32 add_bdri_res = 0;
-
     if ((BDRIRead(0, sizeof(TickDBHeader), &pre_header) != FR_OK) ||
         !CheckDBMagic((u8*) &pre_header, true) ||
-        ((add_bdri_res = AddBDRIEntry(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), title_id,
-            (const u8*) te, entry_size, replace)) == 1) ||
-        (add_bdri_res == REPLACE_SIZE_MISMATCH && ((RemoveBDRIEntry(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), title_id) != 0) ||
-            (AddBDRIEntry(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), title_id,
-            (const u8*) te, entry_size, replace) != 0)))) {
-        free(te);
+        (AddBDRITicket(&(pre_header.fs_header), sizeof(TickDBHeader) - sizeof(BDRIFsHeader), title_id, ticket, replace) != 0)) {
         fvx_close(bdrifp);
         bdrifp = NULL;
         return 1;
     }
 
-    free(te);
     fvx_close(bdrifp);
     bdrifp = NULL;
     return 0;
 }
 
+u32 ApplyBatchToDB(const char* path, bool tickdb, BDRIBatchEntry* batch, u32 n_entries) {
+    FIL file;
+    TitleDBHeader title_header;
+    TickDBHeader tick_header;
+    void* pre_header = tickdb ? (void*) &tick_header : (void*) &title_header;
+    const u32 header_size = tickdb ? sizeof(TickDBHeader) : sizeof(TitleDBHeader);
+    const BDRIFsHeader* fs_header = tickdb ? &(tick_header.fs_header) : &(title_header.fs_header);
+    const u32 fs_header_offset = header_size - sizeof(BDRIFsHeader);
+    u32 ret = 0;
+
+    for (u32 i = 0; i < n_entries; i++)
+        batch[i].result = 1;
+    if (tickdb) InvalidateTitleKeyIndex();
+
+    if (fvx_open(&file, path, FA_READ | FA_WRITE | FA_OPEN_EXISTING) != FR_OK)
+        return 1;
+
+    bdrifp = &file;
+
+    if ((BDRIRead(0, header_size, pre_header) != FR_OK) ||
+        !CheckDBMagic((u8*) pre_header, tickdb)) {
+        fvx_close(bdrifp);
+        bdrifp = NULL;
+        return 1;
+    }
+
+    // the header is only read once, all entries are applied in order
+    for (u32 i = 0; i < n_entries; i++) {
+        BDRIBatchEntry* be = batch + i;
+        u32 size;
+
+        if (!be->entry) { // removing an entry that doesn't exist is not an error here
+            be->result = ((GetBDRIEntrySize(fs_header, fs_header_offset, be->title_id, &size) == 0) &&
+                (RemoveBDRIEntry(fs_header, fs_header_offset, be->title_id) != 0)) ? 1 : 0;
+        } else if (!tickdb) {
+            be->result = (AddBDRIEntry(fs_header, fs_header_offset, be->title_id,
+                (const u8*) be->entry, sizeof(TitleInfoEntry), true) != 0) ? 1 : 0;
+        } else if (AddBDRITicket(fs_header, fs_header_offset, be->title_id, (const Ticket*) be->entry, true) != 0) {
+            // workaround for bug #685
+            RemoveBDRIEntry(fs_header, fs_header_offset, be->title_id);
+            be->result = AddBDRITicket(fs_header, fs_header_offset, be->title_id, (const Ticket*) be->entry, true);
+        } else be->result = 0;
+
+        if (be->result) ret = 1;
+    }
+
+    fvx_close(bdrifp);
+    bdrifp = NULL;
+    return ret;
+}
+
 static u32 CalcNumHashBuckets(u32 num_entries)
 {
     if (num_entries <= 3)
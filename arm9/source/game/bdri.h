@@ -6,16 +6,40 @@
 
 // https://www.3dbrew.org/wiki/Inner_FAT
 
+// ticket.db index entry, title id is in the same format as from ListTicketTitleIDs()
+typedef struct {
+    u8  title_id[8];
+    u8  console_id[4];
+    u8  commonkey_idx;
+    u8  sig_valid; // only set if a signature check was passed to ListTicketIndex()
+    u8  reserved[2];
+    u32 size; // ticket size
+    u8  ticket_sha256[0x20];
+    u8  titlekey[16]; // encrypted
+} TicketIndexEntry;
+
+// signature check for ListTicketIndex(), returns 0 for a valid signature
+typedef u32 (*TicketSigCheck)(const Ticket* ticket, const u8* ticket_sha256);
+
+// title.db / ticket.db change for ApplyBatchToDB()
+typedef struct {
+    u8 title_id[8];
+    const void* entry; // TitleInfoEntry / Ticket to add (or replace), NULL to remove
+    u32 result; // set by ApplyBatchToDB(), 0 on success
+} BDRIBatchEntry;
+
 u32 GetNumTitleInfoEntries(const char* path);
 u32 GetNumTickets(const char* path);
 u32 ListTitleInfoEntryTitleIDs(const char* path, u8* title_ids, u32 max_title_ids);
 u32 ListTicketTitleIDs(const char* path, u8* title_ids, u32 max_title_ids);
+u32 ListTicketIndex(const char* path, TicketIndexEntry* index, u32 max_entries, u32* n_entries, TicketSigCheck sig_check);
 u32 ReadTitleInfoEntryFromDB(const char* path, const u8* title_id, TitleInfoEntry* tie);
 u32 ReadTicketFromDB(const char* path, const u8* title_id, Ticket** ticket);
 u32 RemoveTitleInfoEntryFromDB(const char* path, const u8* title_id);
 u32 RemoveTicketFromDB(const char* path, const u8* title_id);
 u32 AddTitleInfoEntryToDB(const char* path, const u8* title_id, const TitleInfoEntry* tie, bool replace);
 u32 AddTicketToDB(const char* path, const u8* title_id, const Ticket* ticket, bool replace);
+u32 ApplyBatchToDB(const char* path, bool tickdb, BDRIBatchEntry* batch, u32 n_entries);
 
 u32 CreateBDRI(const char *path, u64 image_offset, u64 image_size, u32 blocksize, u32 num_files);
 u32 CreateDbFilesForDrive(const char *destdrv, bool silent, bool force_overwrite);
\ No newline at end of file
@@ -70,26 +70,26 @@ u32 CryptBoss(void* data, u32 offset, u32 size, BossHeader* boss) {
     return 0;
 }
 
-// on the fly de-/encryptor for BOSS - sequential
-u32 CryptBossSequential(void* data, u32 offset, u32 size) {
-    // warning: this will only work for sequential processing
-    // unexpected results otherwise
-    static BossHeader boss = { 0 };
-    static BossHeader* bossptr = NULL;
+void InitBossStream(BossStreamCtx* ctx) {
+    memset(ctx, 0x00, sizeof(BossStreamCtx));
+}
 
+// on the fly de-/encryptor for BOSS, has to start at offset 0
+u32 CryptBossStream(BossStreamCtx* ctx, void* data, u32 offset, u32 size) {
     // fetch boss header from data
     if ((offset == 0) && (size >= sizeof(BossHeader))) {
-        bossptr = NULL;
-        memcpy(&boss, data, sizeof(BossHeader));
-        if (((CheckBossEncrypted(&boss) == 0) &&
-             (CryptBoss((u8*) &boss, 0, sizeof(BossHeader), &boss) != 0)) ||
-            (ValidateBossHeader(&boss, 0) != 0))
+        BossHeader* boss = &(ctx->boss);
+        ctx->has_boss = false;
+        memcpy(boss, data, sizeof(BossHeader));
+        if (((CheckBossEncrypted(boss) == 0) &&
+             (CryptBoss((u8*) boss, 0, sizeof(BossHeader), boss) != 0)) ||
+            (ValidateBossHeader(boss, 0) != 0))
             return 1;
-        bossptr = &boss;
+        ctx->has_boss = true;
     }
 
-    // safety check, boss pointer
-    if (!bossptr) return 1;
+    // safety check, boss header
+    if (!ctx->has_boss) return 1;
 
-    return CryptBoss(data, offset, size, bossptr);
+    return CryptBoss(data, offset, size, &(ctx->boss));
 }
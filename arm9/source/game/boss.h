@@ -37,8 +37,15 @@ typedef struct {
     u8 signature_payload[0x100];
 } PACKED_STRUCT BossHeader;
 
+// on the fly de- / encryption state for one BOSS file
+typedef struct {
+    BossHeader boss; // decrypted
+    bool has_boss;
+} BossStreamCtx;
+
 u32 ValidateBossHeader(BossHeader* header, u32 fsize);
 u32 GetBossPayloadHashHeader(u8* header, BossHeader* boss);
 u32 CheckBossEncrypted(BossHeader* boss);
 u32 CryptBoss(void* data, u32 offset, u32 size, BossHeader* boss);
-u32 CryptBossSequential(void* data, u32 offset, u32 size);
+void InitBossStream(BossStreamCtx* ctx);
+u32 CryptBossStream(BossStreamCtx* ctx, void* data, u32 offset, u32 size);
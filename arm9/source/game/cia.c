@@ -106,8 +106,7 @@ u32 DecryptCiaContentSequential(void* data, u32 size, u8* ctr, const u8* titleke
     u8 tik[16] __attribute__((aligned(32)));
     u32 mode = AES_CNT_TITLEKEY_DECRYPT_MODE;
     memcpy(tik, titlekey, 16);
-    setup_aeskey(0x11, tik);
-    use_aeskey(0x11);
+    use_aeskey_transient(tik);
     cbc_decrypt(data, data, size / 16, mode, ctr);
     return 0;
 }
@@ -117,8 +116,7 @@ u32 EncryptCiaContentSequential(void* data, u32 size, u8* ctr, const u8* titleke
     u8 tik[16] __attribute__((aligned(32)));
     u32 mode = AES_CNT_TITLEKEY_ENCRYPT_MODE;
     memcpy(tik, titlekey, 16);
-    setup_aeskey(0x11, tik);
-    use_aeskey(0x11);
+    use_aeskey_transient(tik);
     cbc_encrypt(data, data, size / 16, mode, ctr);
     return 0;
 }
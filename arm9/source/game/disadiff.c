@@ -135,9 +135,10 @@ u32 CalcIvfcDpfsConfigBlockSize(const IvfcDpfsConfig *config) {
 
 static FIL ddfile;
 static FIL* ddfp = NULL;
+static int ddslot = IMG_SLOT_DRIVE; // image mount slot used when path == NULL
 
 inline static u32 DisaDiffSize(const TCHAR* path) {
-    return path ? fvx_qsize(path) : GetMountSize();
+    return path ? fvx_qsize(path) : GetImageSlotSize(ddslot);
 }
 
 inline static FRESULT DisaDiffOpen(const TCHAR* path) {
@@ -147,7 +148,7 @@ inline static FRESULT DisaDiffOpen(const TCHAR* path) {
     if (path) {
         res = fvx_open(&ddfile, path, FA_READ | FA_WRITE | FA_OPEN_EXISTING);
         if (res == FR_OK) ddfp = &ddfile;
-    } else if (!GetMountState()) res = FR_DENIED;
+    } else if (!GetImageSlotState(ddslot)) res = FR_DENIED;
 
     return res;
 }
@@ -161,7 +162,7 @@ inline static FRESULT DisaDiffRead(void* buf, UINT btr, UINT ofs) {
         res = fvx_read(ddfp, buf, btr, &br);
         if ((res == FR_OK) && (br != btr)) res = FR_DENIED;
         return res;
-    } else return (ReadImageBytes(buf, (u64) ofs, (u64) btr) == 0) ? FR_OK : FR_DENIED;
+    } else return (ReadImageSlotBytes(ddslot, buf, (u64) ofs, (u64) btr) == 0) ? FR_OK : FR_DENIED;
 }
 
 inline static FRESULT DisaDiffWrite(const void* buf, UINT btw, UINT ofs) {
@@ -185,7 +186,7 @@ inline static FRESULT DisaDiffClose() {
 
 inline static FRESULT DisaDiffQRead(const TCHAR* path, void* buf, UINT ofs, UINT btr) {
     if (path) return fvx_qread(path, buf, ofs, btr, NULL);
-    else return (ReadImageBytes(buf, (u64) ofs, (u64) btr) == 0) ? FR_OK : FR_DENIED;
+    else return (ReadImageSlotBytes(ddslot, buf, (u64) ofs, (u64) btr) == 0) ? FR_OK : FR_DENIED;
 }
 
 inline static FRESULT DisaDiffQWrite(const TCHAR* path, const void* buf, UINT ofs, UINT btw) {
@@ -622,6 +623,28 @@ u32 WriteDisaDiffIvfcLvl4(const char* path, const DisaDiffRWInfo* info, u32 offs
     return size;
 }
 
+// read only access to an image in a lookup slot (see OpenImageSlot()), without mounting it
+u32 GetDisaDiffRWInfoSlot(int slot, DisaDiffRWInfo* info, bool partitionB) {
+    ddslot = slot;
+    u32 ret = GetDisaDiffRWInfo(NULL, info, partitionB);
+    ddslot = IMG_SLOT_DRIVE;
+    return ret;
+}
+
+u32 BuildDisaDiffDpfsLvl2CacheSlot(int slot, const DisaDiffRWInfo* info, u8* cache, u32 cache_size) {
+    ddslot = slot;
+    u32 ret = BuildDisaDiffDpfsLvl2Cache(NULL, info, cache, cache_size);
+    ddslot = IMG_SLOT_DRIVE;
+    return ret;
+}
+
+u32 ReadDisaDiffIvfcLvl4Slot(int slot, const DisaDiffRWInfo* info, u32 offset, u32 size, void* buffer) {
+    ddslot = slot;
+    u32 ret = ReadDisaDiffIvfcLvl4(NULL, info, offset, size, buffer);
+    ddslot = IMG_SLOT_DRIVE;
+    return ret;
+}
+
 static inline u64 CalcIvfcTreeSize(const IvfcDescriptor *ivfc, bool ext_lv4) {
     int end_level = ext_lv4 ? 3 : 4;
     return LVL(ivfc, end_level).offset + LVL(ivfc, end_level).size - LVL(ivfc, 1).offset;
@@ -55,5 +55,9 @@ u32 BuildDisaDiffDpfsLvl2Cache(const char* path, const DisaDiffRWInfo* info, u8*
 u32 ReadDisaDiffIvfcLvl4(const char* path, const DisaDiffRWInfo* info, u32 offset, u32 size, void* buffer);
 u32 WriteDisaDiffIvfcLvl4(const char* path, const DisaDiffRWInfo* info, u32 offset, u32 size, const void* buffer);
 
+u32 GetDisaDiffRWInfoSlot(int slot, DisaDiffRWInfo* info, bool partitionB);
+u32 BuildDisaDiffDpfsLvl2CacheSlot(int slot, const DisaDiffRWInfo* info, u8* cache, u32 cache_size);
+u32 ReadDisaDiffIvfcLvl4Slot(int slot, const DisaDiffRWInfo* info, u32 offset, u32 size, void* buffer);
+
 // Not intended for external use other than vdisadiff
 u32 FixDisaDiffIvfcLevel(const DisaDiffRWInfo* info, u32 level, u32 offset, u32 size, u32* next_offset, u32* next_size);
\ No newline at end of file
@@ -189,8 +189,7 @@ u32 SetupSecretKey(u32 keynum) {
 
     // setup the key
     if (got_keys & (0x1<<keynum)) {
-        setup_aeskey(0x11, key);
-        use_aeskey(0x11);
+        use_aeskey_transient(key);
         return 0;
     }
 
@@ -282,35 +281,36 @@ u32 DecryptFirm(void* data, u32 offset, u32 size, FirmHeader* firm, FirmA9LHeade
     return DecryptArm9Binary(data_i, offset_i, size_i, a9l);
 }
 
-u32 DecryptFirmSequential(void* data, u32 offset, u32 size) {
-    // warning: this will only work for sequential processing
+void InitFirmStream(FirmStreamCtx* ctx) {
+    memset(ctx, 0x00, sizeof(FirmStreamCtx));
+}
+
+u32 DecryptFirmStream(FirmStreamCtx* ctx, void* data, u32 offset, u32 size) {
+    // warning: this has to start at offset 0 and pass the ARM9 loader header in one block
     // also, only for blocks aligned to 0x200 bytes
     // unexpected results otherwise
-    static FirmHeader firm = { 0 };
-    static FirmA9LHeader a9l = { 0 };
-    static FirmHeader* firmptr = NULL;
-    static FirmA9LHeader* a9lptr = NULL;
-    static FirmSectionHeader* arm9s = NULL;
+    FirmHeader* firm = &(ctx->firm);
+    FirmA9LHeader* a9l = &(ctx->a9l);
 
     // fetch firm header from data
     if ((offset == 0) && (size >= sizeof(FirmHeader))) {
-        memcpy(&firm, data, sizeof(FirmHeader));
-        firmptr = (ValidateFirmHeader(&firm, 0) == 0) ? &firm : NULL;
-        arm9s = (firmptr) ? FindFirmArm9Section(firmptr) : NULL;
-        a9lptr = NULL;
+        memcpy(firm, data, sizeof(FirmHeader));
+        ctx->has_firm = (ValidateFirmHeader(firm, 0) == 0);
+        ctx->has_a9l = false;
     }
 
-    // safety check, firm header pointer
-    if (!firmptr) return 1;
+    // safety check, firm header
+    if (!ctx->has_firm) return 1;
 
     // fetch ARM9 loader header from data
-    if (arm9s && !a9lptr && (offset <= arm9s->offset) &&
+    FirmSectionHeader* arm9s = FindFirmArm9Section(firm);
+    if (arm9s && !ctx->has_a9l && (offset <= arm9s->offset) &&
         ((offset + size) >= arm9s->offset + sizeof(FirmA9LHeader))) {
-        memcpy(&a9l, (u8*)data + arm9s->offset - offset, sizeof(FirmA9LHeader));
-        a9lptr = (ValidateFirmA9LHeader(&a9l) == 0) ? &a9l : NULL;
+        memcpy(a9l, (u8*)data + arm9s->offset - offset, sizeof(FirmA9LHeader));
+        ctx->has_a9l = (ValidateFirmA9LHeader(a9l) == 0);
     }
 
-    return (a9lptr) ? DecryptFirm(data, offset, size, firmptr, a9lptr) : 0;
+    return (ctx->has_a9l) ? DecryptFirm(data, offset, size, firm, a9l) : 0;
 }
 
 u32 DecryptFirmFull(void* data, u32 size) {
@@ -54,6 +54,14 @@ typedef struct {
     u8  padding[0x190];
 } __attribute__((packed, aligned(16))) FirmA9LHeader;
 
+// on the fly decryption state for one FIRM
+typedef struct {
+    FirmHeader firm;
+    FirmA9LHeader a9l;
+    bool has_firm;
+    bool has_a9l;
+} FirmStreamCtx;
+
 u32 ValidateFirmHeader(FirmHeader* header, u32 data_size);
 u32 ValidateFirmA9LHeader(FirmA9LHeader* header);
 u32 ValidateFirm(void* firm, u32 firm_size, bool installable);
@@ -66,5 +74,6 @@ u32 SetupArm9BinaryCrypto(FirmA9LHeader* header);
 u32 DecryptA9LHeader(FirmA9LHeader* header);
 u32 DecryptFirm(void* data, u32 offset, u32 size, FirmHeader* firm, FirmA9LHeader* a9l);
 u32 DecryptArm9Binary(void* data, u32 offset, u32 size, FirmA9LHeader* a9l);
-u32 DecryptFirmSequential(void* data, u32 offset, u32 size);
+void InitFirmStream(FirmStreamCtx* ctx);
+u32 DecryptFirmStream(FirmStreamCtx* ctx, void* data, u32 offset, u32 size);
 u32 DecryptFirmFull(void* data, u32 size);
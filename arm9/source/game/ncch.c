@@ -70,11 +70,15 @@ u32 GetNcchCtr(u8* ctr, NcchHeader* ncch, u8 section) {
     return 0;
 }
 
+static u32 GetNcchKeyslot(u8 flags3, u32 keyid) {
+    return (!keyid || !flags3) ? 0x2C : // standard / secure3 / secure4 / 7.x crypto
+        (flags3 == 0x0A) ? 0x18 : (flags3 == 0x0B) ? 0x1B : 0x25;
+}
+
 u32 SetNcchKey(NcchHeader* ncch, u16 crypto, u32 keyid) {
     u8 flags3 = (crypto >> 8) & 0xFF;
     u8 flags7 = crypto & 0xFF;
-    u32 keyslot = (!keyid || !flags3) ? 0x2C : // standard / secure3 / secure4 / 7.x crypto
-        (flags3 == 0x0A) ? 0x18 : (flags3 == 0x0B) ? 0x1B : 0x25;
+    u32 keyslot = GetNcchKeyslot(flags3, keyid);
 
     if (flags7 & 0x04)
         return 1;
@@ -85,8 +89,7 @@ u32 SetNcchKey(NcchHeader* ncch, u16 crypto, u32 keyid) {
             0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }; // zero key
         u8 sysKey[16]  = { 0x52, 0x7C, 0xE6, 0x30, 0xA9, 0xCA, 0x30, 0x5F,
             0x36, 0x96, 0xF3, 0xCD, 0xE9, 0x54, 0x19, 0x4B }; // fixed sys key
-        setup_aeskey(0x11, (ncch->programId & ((u64) 0x10 << 32)) ? sysKey : zeroKey);
-        use_aeskey(0x11);
+        use_aeskey_transient((ncch->programId & ((u64) 0x10 << 32)) ? sysKey : zeroKey);
         return 0;
     }
 
@@ -128,6 +131,23 @@ u32 SetupNcchCrypto(NcchHeader* ncch, u16 crypt_to) {
     return res_from | res_to;
 }
 
+// true if both crypto settings result in the same key for this keyid (counters are the same anyways)
+static bool NcchCryptoSameKey(u16 crypto0, u16 crypto1, u32 keyid) {
+    u8 flags3_0 = (crypto0 >> 8) & 0xFF;
+    u8 flags3_1 = (crypto1 >> 8) & 0xFF;
+    u8 flags7_0 = crypto0 & 0xFF;
+    u8 flags7_1 = crypto1 & 0xFF;
+
+    if ((flags7_0 | flags7_1) & 0x04) // no crypto on either side
+        return false;
+    if ((flags7_0 & 0x01) || (flags7_1 & 0x01)) // fixed key crypto, depends on title id only
+        return (flags7_0 & flags7_1 & 0x01);
+
+    // same keyslot and same key Y (seed or signature)
+    return (GetNcchKeyslot(flags3_0, keyid) == GetNcchKeyslot(flags3_1, keyid)) &&
+        (!keyid || ((flags7_0 & 0x20) == (flags7_1 & 0x20)));
+}
+
 u32 CryptNcchSection(void* data, u32 offset_data, u32 size_data, u32 offset_section, u32 size_section,
     u32 offset_ctr, NcchHeader* ncch, u32 snum, u16 crypt_to, u32 keyid) {
     u16 crypt_from = NCCH_GET_CRYPTO(ncch);
@@ -140,6 +160,10 @@ u32 CryptNcchSection(void* data, u32 offset_data, u32 size_data, u32 offset_sect
         return 0; // section not in data
     }
 
+    // re-encryption with an identical keystream is a no-op
+    if (NcchCryptoSameKey(crypt_from, crypt_to, keyid))
+        return 0;
+
     // determine data / offset / size
     u8* data8 = (u8*)data;
     u8* data_i = data8;
@@ -264,48 +288,56 @@ u32 BruteForceNcchCrypto(void* data, u16* crypto) {
     return 1;
 }
 
-// on the fly de- / encryptor for NCCH - sequential
-u32 CryptNcchSequential(void* data, u32 offset, u32 size, u16 crypto) {
-    // warning: this will only work for sequential processing
-    // unexpected results otherwise
-    static NcchHeader ncch = { 0 };
-    static ExeFsHeader exefs = { 0 };
-    static NcchHeader* ncchptr = NULL;
-    static ExeFsHeader* exefsptr = NULL;
-    static u16 crypt_to = NCCH_NOCRYPTO;
+// set up a stream context, NCCH / (decrypted) ExeFS header may be given to allow starting anywhere
+// otherwise these are taken from the data at offset 0 / at the ExeFS offset
+void InitNcchStream(NcchStreamCtx* ctx, const NcchHeader* ncch, const ExeFsHeader* exefs) {
+    memset(ctx, 0x00, sizeof(NcchStreamCtx));
+    ctx->crypt_to = NCCH_NOCRYPTO;
+    if (ncch) {
+        memcpy(&(ctx->ncch), ncch, sizeof(NcchHeader));
+        ctx->has_ncch = (ValidateNcchHeader(&(ctx->ncch)) == 0);
+    }
+    if (ctx->has_ncch && exefs) {
+        memcpy(&(ctx->exefs), exefs, sizeof(ExeFsHeader));
+        ctx->has_exefs = (ValidateExeFsHeader(&(ctx->exefs), 0) == 0);
+    }
+}
 
+// on the fly de- / encryptor for NCCH
+u32 CryptNcchStream(NcchStreamCtx* ctx, void* data, u32 offset, u32 size, u16 crypto) {
     // brute force original crypto
     if (crypto == NCCH_BFCRYPTO) {
         if ((offset == 0) &&
-            ((size < 0xA00) || (BruteForceNcchCrypto(data, &crypt_to) != 0)))
+            ((size < 0xA00) || (BruteForceNcchCrypto(data, &(ctx->crypt_to)) != 0)))
             return 1;
-    } else crypt_to = crypto;
+    } else ctx->crypt_to = crypto;
 
     // fetch ncch header from data
     if ((offset == 0) && (size >= sizeof(NcchHeader))) {
-        memcpy(&ncch, data, sizeof(NcchHeader));
-        ncchptr = (ValidateNcchHeader(&ncch) == 0) ? &ncch : NULL;
-        exefsptr = NULL;
+        memcpy(&(ctx->ncch), data, sizeof(NcchHeader));
+        ctx->has_ncch = (ValidateNcchHeader(&(ctx->ncch)) == 0);
+        ctx->has_exefs = false;
     }
 
-    // safety check, ncch pointer
-    if (!ncchptr) return 1;
+    // safety check, ncch header
+    if (!ctx->has_ncch) return 1;
 
     // fetch exefs header from data
-    if (ncchptr->offset_exefs && !exefsptr) {
-        u32 offset_exefs = ncchptr->offset_exefs * NCCH_MEDIA_UNIT;
+    NcchHeader* ncch = &(ctx->ncch);
+    if (ncch->offset_exefs && !ctx->has_exefs) {
+        u32 offset_exefs = ncch->offset_exefs * NCCH_MEDIA_UNIT;
         if ((offset <= offset_exefs) &&
             ((offset + size) >= offset_exefs + sizeof(ExeFsHeader))) {
-            memcpy(&exefs, (u8*)data + offset_exefs - offset, sizeof(ExeFsHeader));
-            if ((NCCH_ENCRYPTED(ncchptr)) &&
-                (DecryptNcch((u8*) &exefs, offset_exefs, sizeof(ExeFsHeader), ncchptr, NULL) != 0))
+            memcpy(&(ctx->exefs), (u8*)data + offset_exefs - offset, sizeof(ExeFsHeader));
+            if ((NCCH_ENCRYPTED(ncch)) &&
+                (DecryptNcch((u8*) &(ctx->exefs), offset_exefs, sizeof(ExeFsHeader), ncch, NULL) != 0))
                 return 1;
-            if (ValidateExeFsHeader(&exefs, 0) != 0) return 1;
-            exefsptr = &exefs;
+            if (ValidateExeFsHeader(&(ctx->exefs), 0) != 0) return 1;
+            ctx->has_exefs = true;
         }
     }
 
-    return CryptNcch(data, offset, size, ncchptr, exefsptr, crypt_to);
+    return CryptNcch(data, offset, size, ncch, ctx->has_exefs ? &(ctx->exefs) : NULL, ctx->crypt_to);
 }
 
 u32 SetNcchSdFlag(void* data) { // data must be at least 0x600 byte and start with NCCH header
@@ -22,8 +22,8 @@
 // wrapper defines
 #define DecryptNcch(data, offset, size, ncch, exefs) CryptNcch(data, offset, size, ncch, exefs, NCCH_NOCRYPTO)
 #define EncryptNcch(data, offset, size, ncch, exefs, crypto) CryptNcch(data, offset, size, ncch, exefs, crypto)
-#define DecryptNcchSequential(data, offset, size) CryptNcchSequential(data, offset, size, NCCH_NOCRYPTO)
-#define EncryptNcchSequential(data, offset, size, crypto) CryptNcchSequential(data, offset, size, crypto)
+#define DecryptNcchStream(ctx, data, offset, size) CryptNcchStream(ctx, data, offset, size, NCCH_NOCRYPTO)
+#define EncryptNcchStream(ctx, data, offset, size, crypto) CryptNcchStream(ctx, data, offset, size, crypto)
 
 // see: https://www.3dbrew.org/wiki/NCCH/Extended_Header
 // very limited, contains only required stuff
@@ -84,11 +84,21 @@ typedef struct {
     u8  hash_romfs[0x20];
 } __attribute__((packed, aligned(16))) NcchHeader;
 
+// on the fly de- / encryption state for one NCCH
+typedef struct {
+    NcchHeader ncch;
+    ExeFsHeader exefs; // decrypted
+    bool has_ncch;
+    bool has_exefs;
+    u16 crypt_to;
+} NcchStreamCtx;
+
 u32 ValidateNcchHeader(NcchHeader* header);
 u32 ValidateNcchSignature(NcchHeader* header, NcchExtHeader* exthdr);
 u32 SetNcchKey(NcchHeader* ncch, u16 crypto, u32 keyid);
 u32 SetupNcchCrypto(NcchHeader* ncch, u16 crypt_to);
 u32 CryptNcch(void* data, u32 offset, u32 size, NcchHeader* ncch, ExeFsHeader* exefs, u16 crypt_to);
-u32 CryptNcchSequential(void* data, u32 offset, u32 size, u16 crypto);
+void InitNcchStream(NcchStreamCtx* ctx, const NcchHeader* ncch, const ExeFsHeader* exefs);
+u32 CryptNcchStream(NcchStreamCtx* ctx, void* data, u32 offset, u32 size, u16 crypto);
 u32 SetNcchSdFlag(void* data);
 u32 SetupSystemForNcch(NcchHeader* ncch, bool to_emunand);
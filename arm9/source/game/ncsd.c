@@ -45,17 +45,20 @@ u64 GetNcsdTrimmedSize(NcsdHeader* header) {
     return data_units * NCSD_MEDIA_UNIT;
 }
 
-// on the fly decryptor for NCSD
-u32 CryptNcsdSequential(void* data, u32 offset_data, u32 size_data, u16 crypto) {
-    // warning: this will only work for sequential processing
-    static NcsdHeader ncsd;
+void InitNcsdStream(NcsdStreamCtx* ctx) {
+    memset(&(ctx->ncsd), 0x00, sizeof(NcsdHeader));
+    InitNcchStream(&(ctx->ncch), NULL, NULL);
+    ctx->partition = 0;
+}
 
+// on the fly decryptor for NCSD, each partition has to start at its offset 0
+u32 CryptNcsdStream(NcsdStreamCtx* ctx, void* data, u32 offset_data, u32 size_data, u16 crypto) {
     // fetch ncsd header from data
     if ((offset_data == 0) && (size_data >= sizeof(NcsdHeader)))
-        memcpy(&ncsd, data, sizeof(NcsdHeader));
+        memcpy(&(ctx->ncsd), data, sizeof(NcsdHeader));
 
     for (u32 i = 0; i < 8; i++) {
-        NcchPartition* partition = ncsd.partitions + i;
+        NcchPartition* partition = ctx->ncsd.partitions + i;
         u32 offset_p = partition->offset * NCSD_MEDIA_UNIT;
         u32 size_p = partition->size * NCSD_MEDIA_UNIT;
         // check if partition in data
@@ -76,7 +79,11 @@ u32 CryptNcsdSequential(void* data, u32 offset_data, u32 size_data, u16 crypto)
         if (size_i > size_data - (data_i - data8))
             size_i = size_data - (data_i - data8);
         // decrypt ncch segment
-        if (CryptNcchSequential(data_i, offset_i, size_i, crypto) != 0)
+        if (ctx->partition != i) {
+            InitNcchStream(&(ctx->ncch), NULL, NULL);
+            ctx->partition = i;
+        }
+        if (CryptNcchStream(&(ctx->ncch), data_i, offset_i, size_i, crypto) != 0)
             return 1;
     }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common.h"
+#include "ncch.h"
 
 #define NCSD_MEDIA_UNIT     0x200
 
@@ -11,8 +12,8 @@
 #define NCSD_CNT0_OFFSET    0x4000
 
 // wrapper defines
-#define DecryptNcsdSequential(data, offset, size) CryptNcsdSequential(data, offset, size, NCCH_NOCRYPTO)
-#define EncryptNcsdSequential(data, offset, size, crypto) CryptNcsdSequential(data, offset, size, crypto)
+#define DecryptNcsdStream(ctx, data, offset, size) CryptNcsdStream(ctx, data, offset, size, NCCH_NOCRYPTO)
+#define EncryptNcsdStream(ctx, data, offset, size, crypto) CryptNcsdStream(ctx, data, offset, size, crypto)
 
 typedef struct {
     u32 offset;
@@ -37,7 +38,15 @@ typedef struct {
     u8  extra_save_keysel;
 } PACKED_STRUCT NcsdHeader;
 
+// on the fly de- / encryption state for one NCSD
+typedef struct {
+    NcsdHeader ncsd;
+    NcchStreamCtx ncch; // context for the current partition
+    u32 partition;
+} NcsdStreamCtx;
+
 u32 ValidateNcsdHeader(NcsdHeader* header);
 u32 ValidateNcsdSignature(NcsdHeader* header);
 u64 GetNcsdTrimmedSize(NcsdHeader* header);
-u32 CryptNcsdSequential(void* data, u32 offset_data, u32 size_data, u16 crypto);
+void InitNcsdStream(NcsdStreamCtx* ctx);
+u32 CryptNcsdStream(NcsdStreamCtx* ctx, void* data, u32 offset_data, u32 size_data, u16 crypto);
@@ -33,6 +33,25 @@ typedef struct {
     TitleTagEntry tag[TITLETAG_MAX_ENTRIES];
 } PACKED_STRUCT TitleTag;
 
+// seed sources, in order of preference
+#define SEEDIDX_SRC_SYSNAND   0
+#define SEEDIDX_SRC_EMUNAND   1
+#define SEEDIDX_SRC_SEEDDB    2 // seeddb.bin
+#define SEEDIDX_N_SOURCES     3
+
+// lookup index over all seed sources, rebuilt when any source changes
+typedef struct {
+    u64 titleId;
+    u32 rank; // source in the upper 8 bit, position inside the source below
+    u8  reserved[4];
+    Seed seed;
+} PACKED_STRUCT SeedIndexEntry;
+
+static SeedIndexEntry* seedidx = NULL;
+static u32 seedidx_n = 0;
+static u64 seedidx_stamp[SEEDIDX_N_SOURCES] = { 0 };
+static bool seedidx_valid = false;
+
 u32 GetSeedPath(char* path, const char* drv) {
     u8 movable_keyy[16] = { 0 };
     u32 sha256sum[8];
@@ -58,65 +77,126 @@ u32 GetSeedPath(char* path, const char* drv) {
     return 0;
 }
 
-u32 FindSeed(u8* seed, u64 titleId, u32 hash_seed) {
-    static u8 lseed[16+8] __attribute__((aligned(4))) = { 0 }; // seed plus title ID for easy validation
-    u32 sha256sum[8];
+static int compSeedIndexEntry(const void* e1, const void* e2) {
+    const SeedIndexEntry* entry1 = (const SeedIndexEntry*) e1;
+    const SeedIndexEntry* entry2 = (const SeedIndexEntry*) e2;
+    if (entry1->titleId != entry2->titleId) return (entry1->titleId < entry2->titleId) ? -1 : 1;
+    return (entry1->rank < entry2->rank) ? -1 : (entry1->rank > entry2->rank) ? 1 : 0;
+}
 
-    memcpy(lseed+16, &titleId, 8);
-    sha_quick(sha256sum, lseed, 16 + 8, SHA256_MODE);
-    if (hash_seed == sha256sum[0]) {
-        memcpy(seed, lseed, 16);
+static SeedIndexEntry* GrowSeedIndex(u32 n_add) {
+    SeedIndexEntry* seedidx_new = (SeedIndexEntry*) realloc(seedidx, (seedidx_n + n_add) * sizeof(SeedIndexEntry));
+    if (!seedidx_new) return NULL;
+    seedidx = seedidx_new;
+    return seedidx + seedidx_n;
+}
+
+void InvalidateSeedIndex(void) {
+    if (seedidx) free(seedidx);
+    seedidx = NULL;
+    seedidx_n = 0;
+    seedidx_valid = false;
+}
+
+static u32 UpdateSeedIndex(void) {
+    const char* nand_drv[] = {"1:", "4:"}; // SysNAND and EmuNAND
+    char path[countof(nand_drv)][128];
+    u64 stamp[SEEDIDX_N_SOURCES];
+
+    for (u32 i = 0; i < countof(nand_drv); i++)
+        stamp[i] = (GetSeedPath(path[i], nand_drv[i]) == 0) ? GetFileStamp(path[i]) : 0;
+    stamp[SEEDIDX_SRC_SEEDDB] = GetSupportFileStamp(SEEDINFO_NAME);
+
+    // unchanged sources -> nothing to do
+    if (seedidx_valid && (memcmp(stamp, seedidx_stamp, sizeof(stamp)) == 0))
         return 0;
-    }
+    InvalidateSeedIndex();
 
     // setup a large enough buffer
     u8* buffer = (u8*) malloc(max(STD_BUFFER_SIZE, sizeof(SeedDb)));
     if (!buffer) return 1;
-    
-    // try to grab the seed from NAND database
-    const char* nand_drv[] = {"1:", "4:"}; // SysNAND and EmuNAND
+
+    // seeds from the NAND databases
     for (u32 i = 0; i < countof(nand_drv); i++) {
-        char path[128];
         SeedDb* seeddb = (SeedDb*) (void*) buffer;
 
         // read SEEDDB from file
-        if (GetSeedPath(path, nand_drv[i]) != 0) continue;
-        if ((ReadDisaDiffIvfcLvl4(path, NULL, SEEDSAVE_AREA_OFFSET, sizeof(SeedDb), seeddb) != sizeof(SeedDb)) ||
+        if (!stamp[i]) continue;
+        if ((ReadDisaDiffIvfcLvl4(path[i], NULL, SEEDSAVE_AREA_OFFSET, sizeof(SeedDb), seeddb) != sizeof(SeedDb)) ||
             (seeddb->n_entries > SEEDSAVE_MAX_ENTRIES))
             continue;
 
-        // search for the seed
-        for (u32 s = 0; s < seeddb->n_entries; s++) {
-            if (titleId != seeddb->titleId[s]) continue;
-            memcpy(lseed, &(seeddb->seed[s]), sizeof(Seed));
-            sha_quick(sha256sum, lseed, 16 + 8, SHA256_MODE);
-            if (hash_seed == sha256sum[0]) {
-                memcpy(seed, lseed, 16);
-                free(buffer);
-                return 0; // found!
-            }
+        SeedIndexEntry* entry = GrowSeedIndex(seeddb->n_entries);
+        if (!entry) {
+            free(buffer);
+            return 1;
+        }
+        for (u32 s = 0; s < seeddb->n_entries; s++, entry++) {
+            entry->titleId = seeddb->titleId[s];
+            entry->rank = (i << 24) | s;
+            memcpy(&(entry->seed), &(seeddb->seed[s]), sizeof(Seed));
         }
+        seedidx_n += seeddb->n_entries;
     }
-    
-    // not found -> try seeddb.bin
+
+    // seeds from seeddb.bin
     SeedInfo* seeddb = (SeedInfo*) (void*) buffer;
     size_t len = LoadSupportFile(SEEDINFO_NAME, seeddb, STD_BUFFER_SIZE);
     if (len && (seeddb->n_entries <= (len - 16) / 32)) { // check filesize / seeddb size
-        for (u32 s = 0; s < seeddb->n_entries; s++) {
-            if (titleId != seeddb->entries[s].titleId)
-                continue;
-            memcpy(lseed, &(seeddb->entries[s].seed), sizeof(Seed));
-            sha_quick(sha256sum, lseed, 16 + 8, SHA256_MODE);
-            if (hash_seed == sha256sum[0]) {
-                memcpy(seed, lseed, 16);
-                free(buffer);
-                return 0; // found!
-            }
+        SeedIndexEntry* entry = GrowSeedIndex(seeddb->n_entries);
+        if (!entry) {
+            free(buffer);
+            return 1;
+        }
+        for (u32 s = 0; s < seeddb->n_entries; s++, entry++) {
+            entry->titleId = seeddb->entries[s].titleId;
+            entry->rank = (SEEDIDX_SRC_SEEDDB << 24) | s;
+            memcpy(&(entry->seed), &(seeddb->entries[s].seed), sizeof(Seed));
+        }
+        seedidx_n += seeddb->n_entries;
+    }
+    free(buffer);
+
+    // sort by title id, preferred source first
+    qsort(seedidx, seedidx_n, sizeof(SeedIndexEntry), compSeedIndexEntry);
+    memcpy(seedidx_stamp, stamp, sizeof(stamp));
+    seedidx_valid = true;
+
+    return 0;
+}
+
+u32 FindSeed(u8* seed, u64 titleId, u32 hash_seed) {
+    static u8 lseed[16+8] __attribute__((aligned(4))) = { 0 }; // seed plus title ID for easy validation
+    u32 sha256sum[8];
+
+    memcpy(lseed+16, &titleId, 8);
+    sha_quick(sha256sum, lseed, 16 + 8, SHA256_MODE);
+    if (hash_seed == sha256sum[0]) {
+        memcpy(seed, lseed, 16);
+        return 0;
+    }
+
+    // SysNAND / EmuNAND seed save and seeddb.bin, all in one index
+    if (UpdateSeedIndex() != 0)
+        return 1;
+
+    // binary search for the first candidate, then check all candidates for this title id
+    u32 lo = 0, hi = seedidx_n;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if (seedidx[mid].titleId < titleId) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; (lo < seedidx_n) && (seedidx[lo].titleId == titleId); lo++) {
+        memcpy(lseed, &(seedidx[lo].seed), sizeof(Seed));
+        sha_quick(sha256sum, lseed, 16 + 8, SHA256_MODE);
+        if (hash_seed == sha256sum[0]) {
+            memcpy(seed, lseed, 16);
+            return 0; // found!
         }
     }
 
     // out of options -> failed!
-    free(buffer);
     return 1;
 }
 
@@ -163,6 +243,7 @@ u32 InstallSeedDbToSystem(SeedInfo* seed_info, bool to_emunand) {
     // write back to system (warning: no write protection checks here)
     u32 size = WriteDisaDiffIvfcLvl4(path, NULL, SEEDSAVE_AREA_OFFSET, sizeof(SeedDb), seeddb);
     FixFileCmac(path, false);
+    InvalidateSeedIndex();
 
     free (seeddb);
     return (size == sizeof(SeedDb)) ? 0 : 1;
@@ -2,10 +2,27 @@
 #include "bdri.h"
 #include "support.h"
 #include "aes.h"
-#include "fsinit.h"
-#include "image.h"
 
-#define PART_PATH "D:/partitionA.bin"
+// titlekey sources, in order of preference
+#define TIKIDX_SRC_TICKDB   0 // SysNAND ticket.db
+#define TIKIDX_SRC_DEC      1 // decTitleKeys.bin
+#define TIKIDX_SRC_ENC      2 // encTitleKeys.bin
+#define TIKIDX_N_SOURCES    3
+
+// lookup index over all titlekey sources, rebuilt when any source changes
+typedef struct {
+    u8  title_id[8];
+    u8  titlekey[16];
+    u8  commonkey_idx;
+    u8  decrypted; // encrypted at lookup, depends on the ticket (retail / devkit)
+    u8  reserved[2];
+    u32 rank; // source in the upper 8 bit, position inside the source below
+} PACKED_STRUCT TitleKeyIndexEntry;
+
+static TitleKeyIndexEntry* tikidx = NULL;
+static u32 tikidx_n = 0;
+static u64 tikidx_stamp[TIKIDX_N_SOURCES] = { 0 };
+static bool tikidx_valid = false;
 
 u32 CryptTitleKey(TitleKeyEntry* tik, bool encrypt, bool devkit) {
     // From https://github.com/profi200/Project_CTR/blob/master/makerom/pki/prod.h#L19
@@ -34,8 +51,7 @@ u32 CryptTitleKey(TitleKeyEntry* tik, bool encrypt, bool devkit) {
     u8 ctr[16] = { 0 };
 
     if (getbe16(tik->title_id) == 0x3) { // setup TWL key
-        setup_aeskey(0x11, (void*) common_key_twl);
-        use_aeskey(0x11);
+        use_aeskey_transient((void*) common_key_twl);
     } else { // setup key 0x3D // ctr
         if (!devkit) setup_aeskeyY(0x3D, (void*) common_keyy[tik->commonkey_idx]);
         else setup_aeskey(0x3D, (void*) common_key_dev[tik->commonkey_idx]);
@@ -73,73 +89,138 @@ u32 SetTitleKey(const u8* titlekey, Ticket* ticket) {
 
 u32 FindTicket(Ticket** ticket, u8* title_id, bool force_legit, bool emunand) {
     const char* path_db = TICKDB_PATH(emunand); // EmuNAND / SysNAND
-    char path_store[256] = { 0 };
-    char* path_bak = NULL;
 
     // just to be safe
     *ticket = NULL;
 
-    // store previous mount path
-    strncpy(path_store, GetMountPath(), 256);
-    if (*path_store) path_bak = path_store;
-    if (!InitImgFS(path_db))
-        return 1;
-
     // search ticket in database
-    if (ReadTicketFromDB(PART_PATH, title_id, ticket) != 0) {
-        InitImgFS(path_bak);
+    if (ReadTicketFromDB(path_db, title_id, ticket) != 0)
         return 1;
-    }
 
     // (optional) validate ticket signature
     if (force_legit && (ValidateTicketSignature(*ticket) != 0)) {
         free(*ticket);
         *ticket = NULL;
-        InitImgFS(path_bak);
         return 1;
     }
 
-    InitImgFS(path_bak);
     return 0;
 }
 
-u32 FindTitleKey(Ticket* ticket, u8* title_id) {
-    bool found = false;
+static int compTitleKeyIndexEntry(const void* e1, const void* e2) {
+    const TitleKeyIndexEntry* entry1 = (const TitleKeyIndexEntry*) e1;
+    const TitleKeyIndexEntry* entry2 = (const TitleKeyIndexEntry*) e2;
+    int cmp = memcmp(entry1->title_id, entry2->title_id, 8);
+    return (cmp != 0) ? cmp : (entry1->rank < entry2->rank) ? -1 : (entry1->rank > entry2->rank) ? 1 : 0;
+}
 
-    // search for a titlekey inside encTitleKeys.bin / decTitleKeys.bin
-    // when found, add it to the ticket
+static TitleKeyIndexEntry* GrowTitleKeyIndex(u32 n_add) {
+    TitleKeyIndexEntry* tikidx_new = (TitleKeyIndexEntry*) realloc(tikidx, (tikidx_n + n_add) * sizeof(TitleKeyIndexEntry));
+    if (!tikidx_new) return NULL;
+    tikidx = tikidx_new;
+    return tikidx + tikidx_n;
+}
+
+void InvalidateTitleKeyIndex(void) {
+    if (tikidx) free(tikidx);
+    tikidx = NULL;
+    tikidx_n = 0;
+    tikidx_valid = false;
+}
+
+static u32 UpdateTitleKeyIndex(void) {
+    u64 stamp[TIKIDX_N_SOURCES];
+    stamp[TIKIDX_SRC_TICKDB] = GetFileStamp(TICKDB_PATH(false));
+    stamp[TIKIDX_SRC_DEC] = GetSupportFileStamp(TIKDB_NAME_DEC);
+    stamp[TIKIDX_SRC_ENC] = GetSupportFileStamp(TIKDB_NAME_ENC);
+
+    // unchanged sources -> nothing to do
+    if (tikidx_valid && (memcmp(stamp, tikidx_stamp, sizeof(stamp)) == 0))
+        return 0;
+    InvalidateTitleKeyIndex();
+
+    // titlekeys from encTitleKeys.bin / decTitleKeys.bin
     TitleKeysInfo* tikdb = (TitleKeysInfo*) malloc(STD_BUFFER_SIZE); // more than enough
     if (!tikdb) return 1;
-    for (u32 enc = 0; (enc <= 1) && !found; enc++) {
-        u32 len = LoadSupportFile((enc) ? TIKDB_NAME_ENC : TIKDB_NAME_DEC, tikdb, STD_BUFFER_SIZE);
+    for (u32 src = TIKIDX_SRC_DEC; src <= TIKIDX_SRC_ENC; src++) {
+        u32 len = LoadSupportFile((src == TIKIDX_SRC_ENC) ? TIKDB_NAME_ENC : TIKDB_NAME_DEC, tikdb, STD_BUFFER_SIZE);
 
         if (len == 0) continue; // file not found
         if (tikdb->n_entries > (len - 16) / 32)
             continue; // filesize / titlekey db size mismatch
-        for (u32 t = 0; t < tikdb->n_entries; t++) {
+        TitleKeyIndexEntry* entry = GrowTitleKeyIndex(tikdb->n_entries);
+        if (!entry) {
+            free(tikdb);
+            return 1;
+        }
+        for (u32 t = 0; t < tikdb->n_entries; t++, entry++) {
             TitleKeyEntry* tik = tikdb->entries + t;
-            if (memcmp(title_id, tik->title_id, 8) != 0)
-                continue;
-            if (!enc && (CryptTitleKey(tik, true, TICKET_DEVKIT(ticket)) != 0)) // encrypt the key first
-                continue;
-            memcpy(ticket->titlekey, tik->titlekey, 16);
-            ticket->commonkey_idx = tik->commonkey_idx;
-            found = true; // found, inserted
-            break;
+            memcpy(entry->title_id, tik->title_id, 8);
+            memcpy(entry->titlekey, tik->titlekey, 16);
+            entry->commonkey_idx = tik->commonkey_idx;
+            entry->decrypted = (src == TIKIDX_SRC_DEC);
+            entry->rank = (src << 24) | t;
         }
+        tikidx_n += tikdb->n_entries;
     }
     free(tikdb);
 
-    // desperate measures - search in the internal ticket database
-    Ticket* ticket_tmp = NULL;
-    if (FindTicket(&ticket_tmp, title_id, false, false) == 0) {
-        memcpy(ticket->titlekey, ticket_tmp->titlekey, 16);
-        ticket->commonkey_idx = ticket_tmp->commonkey_idx;
-        free(ticket_tmp);
-        found = true;
+    // titlekeys from the internal ticket database
+    {
+        u32 n_tickets = GetNumTickets(TICKDB_PATH(false));
+        TicketIndexEntry* index = (n_tickets) ? (TicketIndexEntry*) malloc(n_tickets * sizeof(TicketIndexEntry)) : NULL;
+        TitleKeyIndexEntry* entry = (index) ? GrowTitleKeyIndex(n_tickets) : NULL;
+        u32 n_index = 0;
+        if (entry && (ListTicketIndex(TICKDB_PATH(false), index, n_tickets, &n_index, NULL) == 0)) {
+            for (u32 t = 0; t < n_index; t++, entry++) {
+                memcpy(entry->title_id, index[t].title_id, 8);
+                memcpy(entry->titlekey, index[t].titlekey, 16);
+                entry->commonkey_idx = index[t].commonkey_idx;
+                entry->decrypted = false;
+                entry->rank = (TIKIDX_SRC_TICKDB << 24) | t;
+            }
+            tikidx_n += n_index;
+        }
+        if (index) free(index);
+    }
+
+    // sort by title id, preferred source first
+    qsort(tikidx, tikidx_n, sizeof(TitleKeyIndexEntry), compTitleKeyIndexEntry);
+    memcpy(tikidx_stamp, stamp, sizeof(stamp));
+    tikidx_valid = true;
+
+    return 0;
+}
+
+u32 FindTitleKey(Ticket* ticket, u8* title_id) {
+    // search for a titlekey in ticket.db, decTitleKeys.bin / encTitleKeys.bin
+    // when found, add it to the ticket
+    if (UpdateTitleKeyIndex() != 0)
+        return 1;
+
+    // binary search for the first entry with this title id
+    u32 lo = 0, hi = tikidx_n;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        if (memcmp(tikidx[mid].title_id, title_id, 8) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    // try all sources in order of preference, until one works
+    TitleKeyIndexEntry* entry_end = tikidx + tikidx_n;
+    for (TitleKeyIndexEntry* entry = tikidx + lo; (entry < entry_end) && (memcmp(entry->title_id, title_id, 8) == 0); entry++) {
+        TitleKeyEntry tik = { 0 };
+        memcpy(tik.title_id, entry->title_id, 8);
+        memcpy(tik.titlekey, entry->titlekey, 16);
+        tik.commonkey_idx = entry->commonkey_idx;
+        if (entry->decrypted && (CryptTitleKey(&tik, true, TICKET_DEVKIT(ticket)) != 0)) // encrypt the key first
+            continue;
+        memcpy(ticket->titlekey, tik.titlekey, 16);
+        ticket->commonkey_idx = tik.commonkey_idx;
+        return 0;
     }
 
-    return (found) ? 0 : 1;
+    return 1; // not found
 }
 
 u32 FindTitleKeyForId(u8* titlekey, u8* title_id) {
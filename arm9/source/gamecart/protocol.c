@@ -30,6 +30,9 @@
 #define REG_AESKEYXFIFO (*(vu32*)0x10009104)
 #define REG_AESKEYYFIFO (*(vu32*)0x10009108)
 
+// from aes.h, which can't be included alongside the above
+void reset_aeskeycache(void);
+
 u32 CartID = 0xFFFFFFFFu;
 u32 CartType = 0;
 
@@ -144,6 +147,7 @@ static u8 card_aes(u32 *out, u32 *buff, size_t size) { // note size param ignore
         REG_AESKEYYFIFO = buff[3];
         REG_AESKEYSEL = 0x3B;
     }
+    reset_aeskeycache(); // keys changed behind the AES driver's back
 
     REG_AESCNT = 0x4000000;
     REG_AESCNT &= 0xFFF7FFFF;
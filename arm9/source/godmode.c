@@ -27,6 +27,7 @@
 #include "pxi.h"
 #include "language.h"
 #include "gm9lua.h"
+#include "crc32.h"
 
 #ifndef N_PANES
 #define N_PANES 3
@@ -40,6 +41,9 @@
 #define BOOTFIRM_PATHS  "0:/bootonce.firm", "0:/boot.firm", "1:/boot.firm"
 #define BOOTFIRM_TEMPS  0x1 // bits mark paths as temporary
 
+#define BUTTON_NAV      (BUTTON_ARROW|BUTTON_L1) // cursor movement / marking, nothing else is drawn
+#define UI_MAX_ROWS     32
+
 #ifdef SALTMODE // ShadowHand's own bootmenu key override
 #undef  BOOTMENU_KEY
 #define BOOTMENU_KEY    BUTTON_START
@@ -165,6 +169,11 @@ static DirStruct* current_dir = NULL;
 static DirStruct* clipboard   = NULL;
 static PaneData* panedata     = NULL;
 
+// screens still show the last main loop frame, only redraw what changed
+static bool ui_keep = false;
+static u32 ui_row_crc[UI_MAX_ROWS];
+static u32 ui_bar_state = 0;
+
 void GetTimeString(char* timestr, bool forced_update, bool full_year) { // timestr should be 32 bytes
     static DsTime dstime;
     static u64 timer = (u64) -1; // this ensures we don't check the time too often
@@ -237,25 +246,29 @@ void DrawTopBar(const char* curr_path) {
     const u32 len_path = SCREEN_WIDTH_TOP - 120;
     char tempstr[UTF_BUFFER_BYTESIZE(63)];
 
-    // top bar - current path
-    DrawRectangle(TOP_SCREEN, 0, 0, SCREEN_WIDTH_TOP, 12, COLOR_TOP_BAR);
-    if (*curr_path) TruncateString(tempstr, curr_path, min(63, len_path / FONT_WIDTH_EXT), 8);
-    else snprintf(tempstr, sizeof(tempstr), "%s", STR_ROOT);
-    DrawStringF(TOP_SCREEN, bartxt_x, bartxt_start, COLOR_STD_BG, COLOR_TOP_BAR, "%s", tempstr);
+    // top bar - current path (unchanged when only the cursor moved)
+    if (!ui_keep) {
+        DrawRectangle(TOP_SCREEN, 0, 0, SCREEN_WIDTH_TOP, 12, COLOR_TOP_BAR);
+        if (*curr_path) TruncateString(tempstr, curr_path, min(63, len_path / FONT_WIDTH_EXT), 8);
+        else snprintf(tempstr, sizeof(tempstr), "%s", STR_ROOT);
+        DrawStringF(TOP_SCREEN, bartxt_x, bartxt_start, COLOR_STD_BG, COLOR_TOP_BAR, "%s", tempstr);
+    }
     bool show_time = true;
 
     #ifdef SHOW_FREE
     if (*curr_path) { // free & total storage
         const u32 bartxt_rx = SCREEN_WIDTH_TOP - (19*FONT_WIDTH_EXT) - bartxt_x;
-        char bytestr0[32];
-        char bytestr1[32];
-        char tempstr[UTF_BUFFER_BYTESIZE(19)];
-        ResizeString(tempstr, STR_LOADING, 19, 19, true);
-        DrawString(TOP_SCREEN, tempstr, bartxt_rx, bartxt_start, COLOR_STD_BG, COLOR_TOP_BAR);
-        FormatBytes(bytestr0, GetFreeSpace(curr_path), true);
-        FormatBytes(bytestr1, GetTotalSpace(curr_path), true);
-        snprintf(tempstr, sizeof(tempstr), "%s/%s", bytestr0, bytestr1);
-        DrawStringF(TOP_SCREEN, bartxt_rx, bartxt_start, COLOR_STD_BG, COLOR_TOP_BAR, "%19.19s", tempstr);
+        if (!ui_keep) {
+            char bytestr0[32];
+            char bytestr1[32];
+            char tempstr[UTF_BUFFER_BYTESIZE(19)];
+            ResizeString(tempstr, STR_LOADING, 19, 19, true);
+            DrawString(TOP_SCREEN, tempstr, bartxt_rx, bartxt_start, COLOR_STD_BG, COLOR_TOP_BAR);
+            FormatBytes(bytestr0, GetFreeSpace(curr_path), true);
+            FormatBytes(bytestr1, GetTotalSpace(curr_path), true);
+            snprintf(tempstr, sizeof(tempstr), "%s/%s", bytestr0, bytestr1);
+            DrawStringF(TOP_SCREEN, bartxt_rx, bartxt_start, COLOR_STD_BG, COLOR_TOP_BAR, "%19.19s", tempstr);
+        }
         show_time = false;
     }
     #elif defined MONITOR_HEAP
@@ -303,12 +316,15 @@ void DrawUserInterface(const char* curr_path, DirEntry* curr_entry, u32 curr_pan
     if (state_prev != state_curr) {
         ClearScreenF(true, false, COLOR_STD_BG);
         state_prev = state_curr;
+        ui_keep = false; // everything on the main screen is gone
     }
 
     // left top - current file info
-    if (curr_pane) snprintf(tempstr, sizeof(tempstr), STR_PANE_N, curr_pane);
-    else snprintf(tempstr, sizeof(tempstr), "%s", STR_CURRENT);
-    DrawStringF(MAIN_SCREEN, 2, info_start, COLOR_STD_FONT, COLOR_STD_BG, "[%s]", tempstr);
+    if (!ui_keep) {
+        if (curr_pane) snprintf(tempstr, sizeof(tempstr), STR_PANE_N, curr_pane);
+        else snprintf(tempstr, sizeof(tempstr), "%s", STR_CURRENT);
+        DrawStringF(MAIN_SCREEN, 2, info_start, COLOR_STD_FONT, COLOR_STD_BG, "[%s]", tempstr);
+    }
     // file / entry name
     ResizeString(tempstr, curr_entry->name, str_len_info, 8, false);
     u32 color_current = COLOR_ENTRY(curr_entry);
@@ -348,6 +364,9 @@ void DrawUserInterface(const char* curr_path, DirEntry* curr_entry, u32 curr_pan
         DrawStringF(MAIN_SCREEN, 4, info_start + 12 + 10 + 10, color_current, COLOR_STD_BG, "%s", tempstr);
     }
 
+    // clipboard and instructions don't change when only the cursor moved
+    if (ui_keep) return;
+
     // right top - clipboard
     DrawStringF(MAIN_SCREEN, SCREEN_WIDTH_MAIN - len_info, info_start, COLOR_STD_FONT, COLOR_STD_BG, "%*s",
         (int) (len_info / FONT_WIDTH_EXT), (clipboard->n_entries) ? STR_CLIPBOARD : "");
@@ -404,7 +423,10 @@ void DrawDirContents(DirStruct* contents, u32 cursor, u32* scroll) {
             ResizeString(namestr, curr_entry->name, str_width - 10, str_width - 20, false);
             snprintf(tempstr, sizeof(tempstr), "%s%s", namestr, bytestr);
         } else snprintf(tempstr, sizeof(tempstr), "%-*.*s", str_width, str_width, "");
-        DrawString(ALT_SCREEN, tempstr, pos_x, pos_y, color_font, COLOR_STD_BG);
+        u32 row_crc = crc32_calculate(color_font, (const u8*) tempstr, strnlen(tempstr, sizeof(tempstr)));
+        if (!ui_keep || (i >= UI_MAX_ROWS) || (ui_row_crc[i] != row_crc))
+            DrawString(ALT_SCREEN, tempstr, pos_x, pos_y, color_font, COLOR_STD_BG);
+        if (i < UI_MAX_ROWS) ui_row_crc[i] = row_crc;
         pos_y += stp_y;
     }
 
@@ -415,11 +437,17 @@ void DrawDirContents(DirStruct* contents, u32 cursor, u32* scroll) {
         u32 bar_height = (lines * flist_height) / contents->n_entries;
         if (bar_height < bar_height_min) bar_height = bar_height_min;
         const u32 bar_pos = ((u64) *scroll * (flist_height - bar_height)) / (contents->n_entries - lines) + start_y;
+        const u32 bar_state = (bar_pos << 16) | bar_height;
 
+        if (ui_keep && (ui_bar_state == bar_state)) return;
+        ui_bar_state = bar_state;
         DrawRectangle(ALT_SCREEN, SCREEN_WIDTH_ALT - bar_width, start_y, bar_width, (bar_pos - start_y), COLOR_STD_BG);
         DrawRectangle(ALT_SCREEN, SCREEN_WIDTH_ALT - bar_width, bar_pos + bar_height, bar_width, SCREEN_HEIGHT - (bar_pos + bar_height), COLOR_STD_BG);
         DrawRectangle(ALT_SCREEN, SCREEN_WIDTH_ALT - bar_width, bar_pos, bar_width, bar_height, COLOR_SIDE_BAR);
-    } else DrawRectangle(ALT_SCREEN, SCREEN_WIDTH_ALT - bar_width, start_y, bar_width, flist_height, COLOR_STD_BG);
+    } else if (!ui_keep || ui_bar_state) {
+        ui_bar_state = 0;
+        DrawRectangle(ALT_SCREEN, SCREEN_WIDTH_ALT - bar_width, start_y, bar_width, flist_height, COLOR_STD_BG);
+    }
 }
 
 u32 LoadLanguageAndFont(const bool setup_language) {
@@ -1776,7 +1804,10 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
         if ((n_marked > 1) && ShowPrompt(true, STR_TRY_TO_INSTALL_N_SELECTED_FILES, n_marked)) {
             u32 n_success = 0;
             u32 n_other = 0;
+            bool* installed = (bool*) calloc(current_dir->n_entries, sizeof(bool));
+            if (!installed) return 1;
             ShowString(STR_TRYING_TO_INSTALL_N_FILES, n_marked);
+            BeginDbBatch(); // database entries are written once, after the loop
             for (u32 i = 0; i < current_dir->n_entries; i++) {
                 const char* path = current_dir->entry[i].path;
                 if (!current_dir->entry[i].marked)
@@ -1786,8 +1817,9 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
                     continue;
                 }
                 DrawDirContents(current_dir, (*cursor = i), scroll);
+                SetDbBatchItem(i);
                 if ((*InstallFunction)(path, to_emunand) == 0)
-                    n_success++;
+                    installed[i] = true;
                 else { // on failure: show error, continue
                     char lpathstr[UTF_BUFFER_BYTESIZE(32)];
                     TruncateString(lpathstr, path, 32, 8);
@@ -1796,6 +1828,10 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
                 }
                 current_dir->entry[i].marked = false;
             }
+            CommitDbBatch(installed, current_dir->n_entries); // database failures undo the success
+            for (u32 i = 0; i < current_dir->n_entries; i++)
+                if (installed[i]) n_success++;
+            free(installed);
             if (n_other) {
                 ShowPrompt(false, STR_N_OF_N_FILES_INSTALLED_N_OF_N_NOT_SAME_TYPE,
                     n_success, n_marked, n_other, n_marked);
@@ -1828,15 +1864,23 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
         if (n_marked > 1) {
             u32 n_success = 0;
             u32 num = 0;
+            bool* uninstalled = (bool*) calloc(current_dir->n_entries, sizeof(bool));
+            if (!uninstalled) return 1;
+            BeginDbBatch(); // database entries are removed once, after the loop
             for (u32 i = 0; i < current_dir->n_entries; i++) {
                 const char* path = current_dir->entry[i].path;
                 if (!current_dir->entry[i].marked) continue;
                 if (!(IdentifyFileType(path) & filetype & TYPE_BASE)) continue;
                 if (!num && !CheckWritePermissions(path)) break;
                 if (!ShowProgress(num++, n_marked, path)) break;
+                SetDbBatchItem(i);
                 if (UninstallGameDataTie(path, true, full_uninstall, full_uninstall) == 0)
-                    n_success++;
+                    uninstalled[i] = true;
             }
+            CommitDbBatch(uninstalled, current_dir->n_entries); // database failures undo the success
+            for (u32 i = 0; i < current_dir->n_entries; i++)
+                if (uninstalled[i]) n_success++;
+            free(uninstalled);
             ShowPrompt(false, STR_N_OF_N_TITLES_UNINSTALLED, n_success, n_marked);
         } else if (CheckWritePermissions(file_path)) {
             ShowString("%s\n%s", pathstr, STR_UNINSTALLING_PLEASE_WAIT);
@@ -1867,7 +1911,12 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
             u32 n_processed = 0;
             if (!ShowPrompt(true, STR_TRY_TO_VERIFY_N_SELECTED_FILES, n_marked)) // confirmation
                 return 1;
-            for (u32 i = 0; i < current_dir->n_entries; i++) {
+            // process in on-disk order, skip files unchanged since they were last verified
+            u32* order = (u32*) malloc(current_dir->n_entries * sizeof(u32));
+            if (order) GetDiskOrder(order, current_dir);
+            OpenVerifyIndex();
+            for (u32 k = 0; k < current_dir->n_entries; k++) {
+                u32 i = (order) ? order[k] : k;
                 const char* path = current_dir->entry[i].path;
                 if (!current_dir->entry[i].marked)
                     continue;
@@ -1879,7 +1928,7 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
                 }
                 DrawDirContents(current_dir, (*cursor = i), scroll);
                 if ((filetype & IMG_NAND) && (ValidateNandDump(path) == 0)) n_success++;
-                else if (VerifyGameFile(path, sig_check) == 0) n_success++;
+                else if (VerifyGameFileIndexed(path, sig_check) == 0) n_success++;
                 else { // on failure: show error, continue
                     char lpathstr[UTF_BUFFER_BYTESIZE(32)];
                     TruncateString(lpathstr, path, 32, 8);
@@ -1891,6 +1940,8 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
                 }
                 current_dir->entry[i].marked = false;
             }
+            CloseVerifyIndex();
+            if (order) free(order);
             if (n_other) ShowPrompt(false, STR_N_OF_N_FILES_VERIFIED_N_OF_N_NOT_SAME_TYPE,
                 n_success, n_marked, n_other, n_marked);
             else ShowPrompt(false, STR_N_OF_N_FILES_VERIFIED, n_success, n_marked);
@@ -2057,12 +2108,12 @@ u32 FileHandlerMenu(char* current_path, u32* cursor, u32* scroll, PaneData** pan
                 DirEntry* entry = &(current_dir->entry[i]);
                 if (!current_dir->entry[i].marked) continue;
                 ShowProgress(i+1, current_dir->n_entries, entry->name);
-                if (!GoodRenamer(entry, false)) continue;
+                if (!GoodRenamer(current_dir, entry, false)) continue;
                 n_success++;
                 current_dir->entry[i].marked = false;
             }
             ShowPrompt(false, STR_N_OF_N_RENAMED, n_success, n_marked);
-        } else if (!GoodRenamer(&(current_dir->entry[*cursor]), true)) {
+        } else if (!GoodRenamer(current_dir, &(current_dir->entry[*cursor]), true)) {
             ShowPrompt(false, "%s\n%s", pathstr, STR_COULD_NOT_RENAME_TO_GOOD_NAME);
         }
         return 0;
@@ -2454,6 +2505,25 @@ u32 HomeMoreMenu(char* current_path) {
     return HomeMoreMenu(current_path);
 }
 
+// fill a lazy listing, keep the cursor on the same entry and screen line (until input if requested)
+static bool FillDirContentsAtCursor(DirStruct* contents, u32* cursor, u32* scroll, bool until_input) {
+    bool more = true;
+    while (more && (!until_input || !(HID_ReadState() & BUTTON_ANY))) {
+        const char* curr_path = contents->entry[*cursor].path; // strings don't move
+        more = FillDirContents(contents);
+        for (u32 c = *cursor; c < contents->n_entries; c++) { // entries only get added
+            if (contents->entry[c].path != curr_path) continue;
+            *scroll += c - *cursor;
+            *cursor = c;
+            break;
+        }
+        ui_keep = true; // called right after the main loop frame
+        DrawDirContents(contents, *cursor, scroll);
+        ui_keep = false;
+    }
+    return more;
+}
+
 u32 GodMode(int entrypoint) {
     const u32 quick_stp = (MAIN_SCREEN == TOP_SCREEN) ? 20 : 19;
     u32 exit_mode = GODMODE_EXIT_POWEROFF;
@@ -2463,6 +2533,8 @@ u32 GodMode(int entrypoint) {
     u32 scroll = 0;
 
     int mark_next = -1;
+    bool lazy_fill = false; // current dir listing still being filled in
+    bool nav_only = false; // last input only moved the cursor, nothing else was drawn since
     u32 last_write_perm = GetWritePermissions();
     u32 last_clipboard_size = 0;
 
@@ -2605,8 +2677,9 @@ u32 GodMode(int entrypoint) {
             return exit_mode;
         }
 
+        InitDirStruct(current_dir);
+        InitDirStruct(clipboard);
         GetDirContents(current_dir, "");
-        clipboard->n_entries = 0;
         memset(panedata, 0x00, N_PANES * sizeof(PaneData));
         ClearScreenF(true, true, COLOR_STD_BG); // clear splash
     }
@@ -2636,9 +2709,11 @@ u32 GodMode(int entrypoint) {
             curr_entry->marked = mark_next;
             mark_next = -2;
         }
+        ui_keep = nav_only;
         DrawDirContents(current_dir, cursor, &scroll);
         DrawUserInterface(current_path, curr_entry, N_PANES ? pane - panedata + 1 : 0);
         DrawTopBar(current_path);
+        ui_keep = nav_only = false;
 
         // check write permissions
         if (~last_write_perm & GetWritePermissions()) {
@@ -2647,9 +2722,18 @@ u32 GodMode(int entrypoint) {
             continue;
         }
 
-        // handle user input
+        // handle user input, fill in a lazy listing until there is some
+        if (lazy_fill) {
+            lazy_fill = FillDirContentsAtCursor(current_dir, &cursor, &scroll, true);
+            curr_entry = &(current_dir->entry[cursor]);
+        }
         u32 pad_state = InputWait(3);
         bool switched = (pad_state & BUTTON_R1);
+        nav_only = !(pad_state & ~(BUTTON_NAV|SHELL_OPEN|BUTTON_WIFI|TIMEOUT_HID));
+        if (lazy_fill && (pad_state & BUTTON_ANY & ~(BUTTON_ARROW|BUTTON_B))) { // anything else needs the full listing
+            lazy_fill = FillDirContentsAtCursor(current_dir, &cursor, &scroll, false);
+            curr_entry = &(current_dir->entry[cursor]);
+        }
 
         // basic navigation commands
         if ((pad_state & BUTTON_A) && (curr_entry->type != T_FILE) && (curr_entry->type != T_DOTDOT)) { // for dirs
@@ -2730,7 +2814,7 @@ u32 GodMode(int entrypoint) {
                         char* last_slash = strrchr(current_path, '/');
                         if (last_slash) *last_slash = '\0';
                     }
-                    GetDirContents(current_dir, current_path);
+                    lazy_fill = GetDirContentsLazy(current_dir, current_path);
                     if (*current_path && (current_dir->n_entries > 1)) {
                         cursor = 1;
                         scroll = 0;
@@ -2864,13 +2948,11 @@ u32 GodMode(int entrypoint) {
                 for (u32 c = 0; c < current_dir->n_entries; c++) {
                     if (current_dir->entry[c].marked) {
                         current_dir->entry[c].marked = 0;
-                        DirEntryCpy(&(clipboard->entry[clipboard->n_entries]), &(current_dir->entry[c]));
-                        clipboard->n_entries++;
+                        DirEntryCpy(clipboard, &(current_dir->entry[c]));
                     }
                 }
                 if ((clipboard->n_entries == 0) && (curr_entry->type != T_DOTDOT)) {
-                    DirEntryCpy(&(clipboard->entry[0]), curr_entry);
-                    clipboard->n_entries = 1;
+                    DirEntryCpy(clipboard, curr_entry);
                 }
                 if (clipboard->n_entries)
                     last_clipboard_size = clipboard->n_entries;
@@ -3113,8 +3195,14 @@ u32 GodMode(int entrypoint) {
     DeinitExtFS();
     DeinitSDCardFS();
 
-    if (current_dir) free(current_dir);
-    if (clipboard) free(clipboard);
+    if (current_dir) {
+        FreeDirStruct(current_dir);
+        free(current_dir);
+    }
+    if (clipboard) {
+        FreeDirStruct(clipboard);
+        free(clipboard);
+    }
     if (panedata) free(panedata);
 
     return exit_mode;
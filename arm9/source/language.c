@@ -147,6 +147,7 @@ int compLanguage(const void* e1, const void* e2) {
 bool LanguageMenu(char* result, const char* title) {
     DirStruct* langDir = (DirStruct*)malloc(sizeof(DirStruct));
     if (!langDir) return false;
+    InitDirStruct(langDir);
 
     char path[256];
     if (!GetSupportDir(path, LANGUAGES_DIR)) return false;
@@ -162,12 +163,13 @@ bool LanguageMenu(char* result, const char* title) {
             size_t fsize = FileGetSize(langDir->entry[i].path);
             FileGetData(langDir->entry[i].path, header, 0x2C0, 0);
             if (GetLanguage(header, fsize, NULL, NULL, langs[langCount].name)) {
-                memcpy(langs[langCount].path, langDir->entry[i].path, 256);
+                strncpy(langs[langCount].path, langDir->entry[i].path, 256);
                 langCount++;
             }
         }
     }
 
+    FreeDirStruct(langDir);
     free(langDir);
     free(header);
 
@@ -54,13 +54,33 @@ static int title_encrypt(lua_State* L) {
 
 static int title_install(lua_State* L) {
     bool extra = CheckLuaArgCountPlusExtra(L, 1, "title.install");
-    const char* path = luaL_checkstring(L, 1);
+    bool batch = lua_istable(L, 1);
+    const char* path = batch ? NULL : luaL_checkstring(L, 1);
 
     u32 flags = 0;
     if (extra) {
         flags = GetFlagsFromTable(L, 2, flags, TO_EMUNAND);
     };
 
+    // a table of paths is installed in one go, title.db / ticket.db are written once at the end
+    if (batch) {
+        lua_Integer n_paths = luaL_len(L, 1);
+        bool ret = true;
+        BeginDbBatch();
+        for (lua_Integer i = 1; ret && (i <= n_paths); i++) {
+            lua_geti(L, 1, i);
+            path = lua_tostring(L, -1);
+            ret = path && (InstallGameFile(path, (flags & TO_EMUNAND)) == 0);
+            if (ret) lua_pop(L, 1); // keep the failed path on the stack for the error message
+        }
+        if (CommitDbBatch(NULL, 0) != 0) {
+            return luaL_error(L, "failed to write title databases");
+        } else if (!ret) {
+            return luaL_error(L, "InstallGameFile failed on %s", path ? path : "(not a string)");
+        }
+        return 0;
+    }
+
     bool ret = (InstallGameFile(path, (flags & TO_EMUNAND)) == 0);
     if (!ret) {
         return luaL_error(L, "InstallGameFile failed on %s", path);
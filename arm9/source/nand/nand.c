@@ -7,6 +7,7 @@
 #include "sdmmc.h"
 #include "image.h"
 #include "memmap.h"
+#include "timer.h"
 
 
 #define KEY95_SHA256    ((IS_DEVKIT) ? slot0x11Key95dev_sha256 : slot0x11Key95_sha256)
@@ -61,6 +62,9 @@ static bool Crypto0x96 = false;
 
 static u32 emunand_base_sector = 0x000000;
 
+static u8* nand_scratch = NULL; // persistent write buffer, allocated on first use
+static NandStats nand_stats = { 0 };
+
 
 bool GetOtp0x90(void* otp0x90, u32 len)
 {
@@ -73,8 +77,7 @@ bool GetOtp0x90(void* otp0x90, u32 len)
     memcpy(otp0x90, (u8*) 0x01FFB800, len);
     if ((LoadKeyFromFile(otp_key, 0x11, 'N', "OTP") == 0) &&
         (LoadKeyFromFile(otp_iv, 0x11, 'I', "OTP") == 0)) {
-        setup_aeskey(0x11, otp_key);
-        use_aeskey(0x11);
+        use_aeskey_transient(otp_key);
         cbc_encrypt(otp0x90, otp0x90, len / 0x10, AES_CNT_TITLEKEY_ENCRYPT_MODE, otp_iv);
         return true;
     }
@@ -228,8 +231,11 @@ void CryptNand(void* buffer, u32 sector, u32 count, u32 keyslot)
     add_ctr(ctr, sector * (0x200 / 0x10));
 
     // decrypt the data
+    u64 timer = timer_start();
     use_aeskey(keyslot);
     ctr_decrypt((void*) buffer, (void*) buffer, blocks, mode, ctr);
+    nand_stats.crypt_ticks += timer_ticks(timer);
+    nand_stats.crypt_bytes += count * 0x200;
 }
 
 void CryptSector0x96(void* buffer, bool encrypt)
@@ -292,7 +298,7 @@ int WriteNandBytes(const void* buffer, u64 offset, u64 count, u32 keyslot, u32 n
             errorcode = ReadNandSectors(l_buffer, offset / 0x200, 1, keyslot, nand_dst);
             if (errorcode != 0) return errorcode;
             memcpy(l_buffer + 0x200 - offset_fix, buffer8, min(offset_fix, count));
-            errorcode = WriteNandSectors((const u8*) l_buffer, offset / 0x200, 1, keyslot, nand_dst);
+            errorcode = WriteNandSectorsInPlace(l_buffer, offset / 0x200, 1, keyslot, nand_dst);
             if (errorcode != 0) return errorcode;
             if (count <= offset_fix) return 0;
             offset += offset_fix;
@@ -308,7 +314,7 @@ int WriteNandBytes(const void* buffer, u64 offset, u64 count, u32 keyslot, u32 n
             errorcode = ReadNandSectors(l_buffer, (offset + count) / 0x200, 1, keyslot, nand_dst);
             if (errorcode != 0) return errorcode;
             memcpy(l_buffer, buffer8 + count - count_fix, count_fix);
-            errorcode = WriteNandSectors((const u8*) l_buffer, (offset + count) / 0x200, 1, keyslot, nand_dst);
+            errorcode = WriteNandSectorsInPlace(l_buffer, (offset + count) / 0x200, 1, keyslot, nand_dst);
             if (errorcode != 0) return errorcode;
         }
         return errorcode;
@@ -319,6 +325,7 @@ int ReadNandSectors(void* buffer, u32 sector, u32 count, u32 keyslot, u32 nand_s
 {
     u8* buffer8 = (u8*) buffer;
     if (!count) return 0; // <--- just to be safe
+    u64 timer = timer_start();
     if (nand_src == NAND_EMUNAND) { // EmuNAND
         int errorcode = 0;
         if ((sector == 0) && (emunand_base_sector % 0x200000 == 0)) { // GW EmuNAND header handling
@@ -341,42 +348,78 @@ int ReadNandSectors(void* buffer, u32 sector, u32 count, u32 keyslot, u32 nand_s
     } else {
         return -1;
     }
+    nand_stats.io_ticks += timer_ticks(timer);
+    nand_stats.read_bytes += count * 0x200;
     if ((keyslot == 0x11) && (sector == SECTOR_SECRET)) CryptSector0x96(buffer8, false);
     else if (keyslot < 0x40) CryptNand(buffer8, sector, count, keyslot);
 
     return 0;
 }
 
+static int WriteNandSectorsRaw(const void* buffer, u32 sector, u32 count, u32 nand_dst)
+{
+    // buffer is already encrypted (or needs no crypto), write it as is
+    const u8* buffer8 = (const u8*) buffer;
+    int errorcode = 0;
+    u64 timer = timer_start();
+    if (nand_dst == NAND_EMUNAND) {
+        if ((sector == 0) && (emunand_base_sector % 0x200000 == 0)) { // GW EmuNAND header handling
+            errorcode = sdmmc_sdcard_writesectors(emunand_base_sector + getMMCDevice(0)->total_size, 1, buffer8);
+            if (!errorcode && (count > 1)) errorcode = sdmmc_sdcard_writesectors(emunand_base_sector + 1, count - 1, buffer8 + 0x200);
+        } else errorcode = sdmmc_sdcard_writesectors(emunand_base_sector + sector, count, buffer8);
+    } else if (nand_dst == NAND_IMGNAND) {
+        errorcode = WriteImageSectors(buffer8, sector, count);
+    } else if (nand_dst == NAND_SYSNAND) {
+        errorcode = sdmmc_nand_writesectors(sector, count, buffer8);
+    } else {
+        errorcode = -1;
+    }
+    nand_stats.io_ticks += timer_ticks(timer);
+    if (!errorcode) nand_stats.write_bytes += count * 0x200;
+
+    return errorcode;
+}
+
 int WriteNandSectors(const void* buffer, u32 sector, u32 count, u32 keyslot, u32 nand_dst)
 {
+    // no crypto -> no need to copy anything
+    if (!count) return 0;
+    if (keyslot >= 0x40) return WriteNandSectorsRaw(buffer, sector, count, nand_dst);
+
     // buffer must not be changed, so this is a little complicated
-    void* nand_buffer = (void*) malloc(min(STD_BUFFER_SIZE, count * 0x200));
-    if (!nand_buffer) return -1;
+    if (!nand_scratch) nand_scratch = (u8*) malloc(NAND_BUFFER_SIZE);
+    if (!nand_scratch) return -1;
+    void* nand_buffer = (void*) nand_scratch;
     int errorcode = 0;
 
-    for (u32 s = 0; s < count; s += (STD_BUFFER_SIZE / 0x200)) {
-        u32 pcount = min((STD_BUFFER_SIZE/0x200), (count - s));
+    for (u32 s = 0; (s < count) && !errorcode; s += (NAND_BUFFER_SIZE / 0x200)) {
+        u32 pcount = min((NAND_BUFFER_SIZE/0x200), (count - s));
         memcpy(nand_buffer, ((u8*) buffer) + (s*0x200), pcount * 0x200);
-        if ((keyslot == 0x11) && (sector == SECTOR_SECRET)) CryptSector0x96(nand_buffer, true);
-        else if (keyslot < 0x40) CryptNand(nand_buffer, sector + s, pcount, keyslot);
-        if (nand_dst == NAND_EMUNAND) {
-            if ((sector + s == 0) && (emunand_base_sector % 0x200000 == 0)) { // GW EmuNAND header handling
-                errorcode = sdmmc_sdcard_writesectors(emunand_base_sector + getMMCDevice(0)->total_size, 1, nand_buffer);
-                if (!errorcode && (pcount > 1)) errorcode = sdmmc_sdcard_writesectors(emunand_base_sector + 1, pcount - 1, ((u8*) nand_buffer) + 0x200);
-            } else errorcode = sdmmc_sdcard_writesectors(emunand_base_sector + sector + s, pcount, nand_buffer);
-        } else if (nand_dst == NAND_IMGNAND) {
-            errorcode = WriteImageSectors(nand_buffer, sector + s, pcount);
-        } else if (nand_dst == NAND_SYSNAND) {
-            errorcode = sdmmc_nand_writesectors(sector + s, pcount, nand_buffer);
-        } else {
-            errorcode = -1;
-        }
+        errorcode = WriteNandSectorsInPlace(nand_buffer, sector + s, pcount, keyslot, nand_dst);
     }
 
-    free(nand_buffer);
     return errorcode;
 }
 
+int WriteNandSectorsInPlace(void* buffer, u32 sector, u32 count, u32 keyslot, u32 nand_dst)
+{
+    // buffer is encrypted in place, its content is lost afterwards
+    if (!count) return 0;
+    if ((keyslot == 0x11) && (sector == SECTOR_SECRET)) CryptSector0x96(buffer, true);
+    else if (keyslot < 0x40) CryptNand(buffer, sector, count, keyslot);
+    return WriteNandSectorsRaw(buffer, sector, count, nand_dst);
+}
+
+void GetNandStats(NandStats* stats)
+{
+    memcpy(stats, &nand_stats, sizeof(NandStats));
+}
+
+void ResetNandStats(void)
+{
+    memset(&nand_stats, 0x00, sizeof(NandStats));
+}
+
 u32 ValidateSecretSector(u8* sector)
 {
     return (sha_cmp(SECTOR_SHA256, sector, 0x200, SHA256_MODE) == 0) ? 0 : 1;
@@ -9,6 +9,8 @@
 #define NAND_IMGNAND    (1UL<<2)
 #define NAND_ZERONAND   (1UL<<3)
 
+#define NAND_BUFFER_SIZE    STD_BUFFER_SIZE // must be a multiple of 0x200
+
 #define BOOT_UNKNOWN    0
 #define BOOT_NAND       (1UL<<0)
 #define BOOT_NTRBOOT    (1UL<<1)
@@ -51,6 +53,15 @@ typedef struct {
     u32 keyslot;
 } PACKED_STRUCT NandPartitionInfo;
 
+// throughput counters, ticks are in TICKS_PER_SEC units
+typedef struct {
+    u64 read_bytes;
+    u64 write_bytes;
+    u64 crypt_bytes;
+    u64 io_ticks;
+    u64 crypt_ticks;
+} NandStats;
+
 typedef struct {
     u32 offset;
     u32 size;
@@ -81,6 +92,9 @@ int ReadNandBytes(void* buffer, u64 offset, u64 count, u32 keyslot, u32 nand_src
 int WriteNandBytes(const void* buffer, u64 offset, u64 count, u32 keyslot, u32 nand_dst);
 int ReadNandSectors(void* buffer, u32 sector, u32 count, u32 keyslot, u32 nand_src);
 int WriteNandSectors(const void* buffer, u32 sector, u32 count, u32 keyslot, u32 nand_dest);
+int WriteNandSectorsInPlace(void* buffer, u32 sector, u32 count, u32 keyslot, u32 nand_dest);
+void GetNandStats(NandStats* stats);
+void ResetNandStats(void);
 
 u32 ValidateNandNcsdHeader(NandNcsdHeader* header);
 u32 GetNandNcsdMinSizeSectors(NandNcsdHeader* ncsd);
@@ -39,8 +39,7 @@ u32 GetCbcBlocks(FIL* file, void* buffer, u64 offset, u32 count, u8* titlekey, u
 
     // decrypt
     if (titlekey) {
-        setup_aeskey(0x11, titlekey);
-        use_aeskey(0x11);
+        use_aeskey_transient(titlekey);
         cbc_decrypt(buffer, buffer, count / 0x10, AES_CNT_TITLEKEY_DECRYPT_MODE, iv);
     }
 
@@ -79,26 +78,59 @@ u32 GetNcchHeaders(NcchHeader* ncch, NcchExtHeader* exthdr, ExeFsHeader* exefs,
     return 0;
 }
 
-u32 CheckNcchHash(u8* expected, FIL* file, u32 size_data, u32 offset_ncch, NcchHeader* ncch, ExeFsHeader* exefs) {
-    u32 offset_data = fvx_tell(file) - offset_ncch;
+typedef struct {
+    FIL* file;
+    u32 offset_ncch;
+    NcchHeader* ncch;
+    ExeFsHeader* exefs;
+    u8* buffer; // STD_BUFFER_SIZE
+    const char* path; // for progress display
+    u64 done;
+    u64 total;
+} NcchVerifyCtx;
+
+#define NCCH_VERIFY_CANCELED    2 // returned when the user cancels, verification stops
+
+// hashes data in blocks of block_size, compares against consecutive expected hashes
+// (or stores them to hashes_out instead if that is not NULL, for checking them later)
+// data is read in large chunks, a seek only happens when not already at the right position
+static u32 CheckNcchHashBlocks(NcchVerifyCtx* ctx, const u8* expected, u8* hashes_out, u64 offset_data, u64 size_data, u32 block_size) {
+    u64 pos = ctx->offset_ncch + offset_data;
+    u32 block_left = 0;
     u8 hash[32];
 
-    u8* buffer = (u8*) malloc(STD_BUFFER_SIZE);
-    if (!buffer) return 1;
-
-    sha_init(SHA256_MODE);
-    for (u32 i = 0; i < size_data; i += STD_BUFFER_SIZE) {
+    if ((fvx_tell(ctx->file) != pos) && (fvx_lseek(ctx->file, pos) != FR_OK))
+        return 1;
+    for (u64 i = 0; i < size_data;) {
         u32 read_bytes = min(STD_BUFFER_SIZE, (size_data - i));
         UINT bytes_read;
-        fvx_read(file, buffer, read_bytes, &bytes_read);
-        DecryptNcch(buffer, offset_data + i, read_bytes, ncch, exefs);
-        sha_update(buffer, read_bytes);
+        if ((fvx_read(ctx->file, ctx->buffer, read_bytes, &bytes_read) != FR_OK) || (bytes_read != read_bytes) ||
+            (DecryptNcch(ctx->buffer, offset_data + i, read_bytes, ctx->ncch, ctx->exefs) != 0))
+            return 1;
+        for (u32 p = 0; p < read_bytes;) { // blocks may span chunks
+            if (!block_left) {
+                block_left = min(block_size, (size_data - (i + p)));
+                sha_init(SHA256_MODE);
+            }
+            u32 len = min(block_left, read_bytes - p);
+            sha_update(ctx->buffer + p, len);
+            block_left -= len;
+            p += len;
+            if (!block_left && hashes_out) {
+                sha_get(hashes_out);
+                hashes_out += 32;
+            } else if (!block_left) {
+                sha_get(hash);
+                if (memcmp(hash, expected, 32) != 0) return 1;
+                expected += 32;
+            }
+        }
+        i += read_bytes;
+        ctx->done += read_bytes;
+        if (!ShowProgress(ctx->done, ctx->total, ctx->path)) return NCCH_VERIFY_CANCELED;
     }
-    sha_get(hash);
-
-    free(buffer);
 
-    return (memcmp(hash, expected, 32) == 0) ? 0 : 1;
+    return 0;
 }
 
 u32 LoadNcchHeaders(NcchHeader* ncch, NcchExtHeader* exthdr, ExeFsHeader* exefs, const char* path, u32 offset) {
@@ -305,26 +337,16 @@ u32 LoadTicketForTitleId(Ticket** ticket, const u64 title_id) {
     for (u32 i = 0; i < 8; i++)
         tid[7-i] = (title_id >> (i*8)) & 0xFF;
 
-    // ensure remounting the old mount path
-    char path_store[256] = { 0 };
-    char* path_bak = NULL;
-    strncpy(path_store, GetMountPath(), 256);
-    if (*path_store) path_bak = path_store;
-
     // path to ticket.db
     char path_ticketdb[32];
-    char drv = *path_store;
+    char drv = *GetMountPath();
     snprintf(path_ticketdb, sizeof(path_ticketdb), "%2.2s/dbs/ticket.db",
         ((drv == 'B') || (drv == '5') || (drv == '4')) ? "4:" : "1:");
 
-    // load ticket
-    if (!InitImgFS(path_ticketdb) ||
-        ((ReadTicketFromDB(PART_PATH, tid, ticket)) != 0))
+    // load ticket (read straight from the container, mount stays untouched)
+    if (ReadTicketFromDB(path_ticketdb, tid, ticket) != 0)
         *ticket = NULL;
 
-    // remount old path
-    InitImgFS(path_bak);
-
     return (*ticket) ? 0 : 1;
 }
 
@@ -602,121 +624,139 @@ u32 VerifyNcchFile(const char* path, u32 offset, u32 size, bool sig_check) {
     u32 ver_exefs = 0;
     u32 ver_romfs = 0;
 
-    // base hash check for extheader
-    if (ncch.size_exthdr > 0) {
-        fvx_lseek(&file, offset + NCCH_EXTHDR_OFFSET);
-        ver_exthdr = CheckNcchHash(ncch.hash_exthdr, &file, 0x400, offset, &ncch, NULL);
+    // single read buffer for the whole verification
+    u8* buffer = (u8*) malloc(STD_BUFFER_SIZE);
+    if (!buffer) {
+        fvx_close(&file);
+        return 1;
     }
 
-    // base hash check for exefs
-    if (ncch.size_exefs > 0) {
-        fvx_lseek(&file, offset + (ncch.offset_exefs * NCCH_MEDIA_UNIT));
-        ver_exefs = CheckNcchHash(ncch.hash_exefs, &file, ncch.size_exefs_hash * NCCH_MEDIA_UNIT, offset, &ncch, &exefs);
-    }
+    NcchVerifyCtx ctx = {
+        .file = &file,
+        .offset_ncch = offset,
+        .ncch = &ncch,
+        .exefs = &exefs,
+        .buffer = buffer,
+        .path = path,
+        .done = 0,
+        .total = 0
+    };
 
-    // base hash check for romfs
-    if (ncch.size_romfs > 0) {
-        fvx_lseek(&file, offset + (ncch.offset_romfs * NCCH_MEDIA_UNIT));
-        ver_romfs = CheckNcchHash(ncch.hash_romfs, &file, ncch.size_romfs_hash * NCCH_MEDIA_UNIT, offset, &ncch, NULL);
+    // thorough exefs verification (workaround for Process9)
+    bool exefs_files = (ncch.size_exefs > 0) && (memcmp(exthdr.name, "Process9", 8) != 0);
+
+    // progress is tracked over all bytes read in the main pass (romfs is close enough)
+    if (ncch.size_exthdr > 0) ctx.total += 0x400;
+    if (ncch.size_exefs > 0) ctx.total += ncch.size_exefs_hash * NCCH_MEDIA_UNIT;
+    for (u32 i = 0; exefs_files && (i < 10); i++) ctx.total += exefs.files[i].size;
+    if (ncch.size_romfs > 0) ctx.total += ncch.size_romfs * NCCH_MEDIA_UNIT;
+    if (!ShowProgress(0, 0, path)) {
+        free(buffer);
+        fvx_close(&file);
+        return 1;
     }
 
-    // thorough exefs verification (workaround for Process9)
-    if (!ShowProgress(0, 0, path)) return 1;
-    if ((ncch.size_exefs > 0) && (memcmp(exthdr.name, "Process9", 8) != 0)) {
-        for (u32 i = 0; !ver_exefs && (i < 10); i++) {
+    // main pass, everything is read once in on-disk order:
+    // extheader, exefs superblock and files, romfs superblock, lvl3, lvl1 and lvl2
+    if (ncch.size_exthdr > 0)
+        ver_exthdr = CheckNcchHashBlocks(&ctx, ncch.hash_exthdr, NULL, NCCH_EXTHDR_OFFSET, 0x400, 0x400);
+    bool canceled = (ver_exthdr == NCCH_VERIFY_CANCELED);
+
+    if (!canceled && (ncch.size_exefs > 0)) {
+        u32 offset_exefs = ncch.offset_exefs * NCCH_MEDIA_UNIT;
+        u32 size_exefs_hash = ncch.size_exefs_hash * NCCH_MEDIA_UNIT;
+        ver_exefs = CheckNcchHashBlocks(&ctx, ncch.hash_exefs, NULL, offset_exefs, size_exefs_hash, size_exefs_hash);
+        for (u32 i = 0; exefs_files && !ver_exefs && (i < 10); i++) {
             ExeFsFileHeader* exefile = exefs.files + i;
-            u8* hash = exefs.hashes[9 - i];
             if (!exefile->size) continue;
-            fvx_lseek(&file, offset + (ncch.offset_exefs * NCCH_MEDIA_UNIT) + 0x200 + exefile->offset);
-            ver_exefs = CheckNcchHash(hash, &file, exefile->size, offset, &ncch, &exefs);
+            ver_exefs = CheckNcchHashBlocks(&ctx, exefs.hashes[9 - i], NULL, offset_exefs + 0x200 + exefile->offset,
+                exefile->size, exefile->size);
         }
+        canceled = (ver_exefs == NCCH_VERIFY_CANCELED);
     }
 
-    // thorough romfs verification
-    if (!ver_romfs && (ncch.size_romfs > 0)) {
-        UINT btr;
-
-        // load ivfc header
+    if (!canceled && (ncch.size_romfs > 0)) {
+        u64 offset_romfs = ncch.offset_romfs * NCCH_MEDIA_UNIT;
+        u32 size_romfs_hash = ncch.size_romfs_hash * NCCH_MEDIA_UNIT;
         RomFsIvfcHeader ivfc;
-        fvx_lseek(&file, offset + (ncch.offset_romfs * NCCH_MEDIA_UNIT));
-        if ((fvx_read(&file, &ivfc, sizeof(RomFsIvfcHeader), &btr) != FR_OK) ||
-            (DecryptNcch((u8*) &ivfc, ncch.offset_romfs * NCCH_MEDIA_UNIT, sizeof(RomFsIvfcHeader), &ncch, NULL) != 0) )
-            ver_romfs = 1;
-
-        // load data
+        u8* masterhash = NULL;
+        u8* lvl3_hashes = NULL;
+        u8* lvl12_data = NULL;
         u64 lvl1_size = 0;
         u64 lvl2_size = 0;
-        u8* masterhash = NULL;
-        u8* lvl1_data = NULL;
-        u8* lvl2_data = NULL;
-        if (!ver_romfs && (ValidateRomFsHeader(&ivfc, ncch.size_romfs * NCCH_MEDIA_UNIT) == 0)) {
-            // load masterhash(es)
-            masterhash = malloc(ivfc.size_masterhash);
-            if (masterhash) {
-                u64 offset_add = (ncch.offset_romfs * NCCH_MEDIA_UNIT) + sizeof(RomFsIvfcHeader);
-                fvx_lseek(&file, offset + offset_add);
-                if ((fvx_read(&file, masterhash, ivfc.size_masterhash, &btr) != FR_OK) ||
-                    (DecryptNcch(masterhash, offset_add, ivfc.size_masterhash, &ncch, NULL) != 0))
-                    ver_romfs = 1;
-            }
+        u64 lvl3_size = 0;
+        UINT btr;
 
-            // load lvl1
-            lvl1_size = align(ivfc.size_lvl1, 1 << ivfc.log_lvl1);
-            lvl1_data = malloc(lvl1_size);
-            if (lvl1_data) {
-                u64 offset_add = (ncch.offset_romfs * NCCH_MEDIA_UNIT) + GetRomFsLvOffset(&ivfc, 1);
-                fvx_lseek(&file, offset + offset_add);
-                if ((fvx_read(&file, lvl1_data, lvl1_size, &btr) != FR_OK) ||
-                    (DecryptNcch(lvl1_data, offset_add, lvl1_size, &ncch, NULL) != 0))
-                    ver_romfs = 1;
-            }
+        // superblock hash covers the ivfc header and masterhash, these are taken from the read buffer
+        ver_romfs = CheckNcchHashBlocks(&ctx, ncch.hash_romfs, NULL, offset_romfs, size_romfs_hash, size_romfs_hash);
+        u32 sb_size = (size_romfs_hash <= STD_BUFFER_SIZE) ? size_romfs_hash : 0; // decrypted superblock still in buffer
+        if (!ver_romfs) {
+            if (sb_size >= sizeof(RomFsIvfcHeader)) memcpy(&ivfc, buffer, sizeof(RomFsIvfcHeader));
+            else if ((fvx_lseek(&file, offset + offset_romfs) != FR_OK) ||
+                (fvx_read(&file, &ivfc, sizeof(RomFsIvfcHeader), &btr) != FR_OK) ||
+                (DecryptNcch((u8*) &ivfc, offset_romfs, sizeof(RomFsIvfcHeader), &ncch, NULL) != 0))
+                ver_romfs = 1;
+            if (!ver_romfs && (ValidateRomFsHeader(&ivfc, ncch.size_romfs * NCCH_MEDIA_UNIT) != 0))
+                ver_romfs = 1;
+        }
 
-            // load lvl2
+        if (!ver_romfs) {
+            lvl1_size = align(ivfc.size_lvl1, 1 << ivfc.log_lvl1);
             lvl2_size = align(ivfc.size_lvl2, 1 << ivfc.log_lvl2);
-            lvl2_data = malloc(lvl2_size);
-            if (lvl2_data) {
-                u64 offset_add = (ncch.offset_romfs * NCCH_MEDIA_UNIT) + GetRomFsLvOffset(&ivfc, 2);
-                fvx_lseek(&file, offset + offset_add);
-                if ((fvx_read(&file, lvl2_data, lvl2_size, &btr) != FR_OK) ||
-                    (DecryptNcch(lvl2_data, offset_add, lvl2_size, &ncch, NULL) != 0))
-                    ver_romfs = 1;
-            }
-
-            // check mallocs
-            if (!masterhash || !lvl1_data || !lvl2_data)
-                ver_romfs = 1; // should never happen
+            lvl3_size = align(ivfc.size_lvl3, 1 << ivfc.log_lvl3);
+            masterhash = malloc(ivfc.size_masterhash);
+            lvl3_hashes = malloc((lvl3_size >> ivfc.log_lvl3) * 0x20);
+            lvl12_data = malloc(lvl1_size + lvl2_size);
+            if (!masterhash || !lvl3_hashes || !lvl12_data) ver_romfs = 1; // should never happen
         }
 
-        // actual verification
+        // masterhash directly follows the ivfc header
         if (!ver_romfs) {
-            // verify lvl1
-            u32 n_blocks = lvl1_size >> ivfc.log_lvl1;
-            u32 block_log = ivfc.log_lvl1;
-            for (u32 i = 0; !ver_romfs && (i < n_blocks); i++)
-                ver_romfs = (u32) sha_cmp(masterhash + (i*0x20), lvl1_data + (i<<block_log), 1<<block_log, SHA256_MODE);
-
-            // verify lvl2
-            n_blocks = lvl2_size >> ivfc.log_lvl2;
-            block_log = ivfc.log_lvl2;
-            for (u32 i = 0; !ver_romfs && (i < n_blocks); i++) {
-                ver_romfs = sha_cmp(lvl1_data + (i*0x20), lvl2_data + (i<<block_log), 1<<block_log, SHA256_MODE);
-            }
+            u64 offset_add = offset_romfs + sizeof(RomFsIvfcHeader);
+            if (sb_size >= sizeof(RomFsIvfcHeader) + ivfc.size_masterhash)
+                memcpy(masterhash, buffer + sizeof(RomFsIvfcHeader), ivfc.size_masterhash);
+            else if ((fvx_lseek(&file, offset + offset_add) != FR_OK) ||
+                (fvx_read(&file, masterhash, ivfc.size_masterhash, &btr) != FR_OK) ||
+                (DecryptNcch(masterhash, offset_add, ivfc.size_masterhash, &ncch, NULL) != 0))
+                ver_romfs = 1;
+        }
 
-            // lvl3 verification (this will take long)
-            u64 offset_add = (ncch.offset_romfs * NCCH_MEDIA_UNIT) + GetRomFsLvOffset(&ivfc, 3);
-            n_blocks = align(ivfc.size_lvl3, 1 << ivfc.log_lvl3) >> ivfc.log_lvl3;
-            block_log = ivfc.log_lvl3;
-            fvx_lseek(&file, offset + offset_add);
-            for (u32 i = 0; !ver_romfs && (i < n_blocks); i++) {
-                ver_romfs = CheckNcchHash(lvl2_data + (i*0x20), &file, 1 << block_log, offset, &ncch, NULL);
-                offset_add += 1 << block_log;
-                if (!(i % 16) && !ShowProgress(i+1, n_blocks, path)) ver_romfs = 1;
-            }
+        // lvl3 comes first on disk, its hashes are checked against lvl2 later (this will take long)
+        if (!ver_romfs)
+            ver_romfs = CheckNcchHashBlocks(&ctx, NULL, lvl3_hashes, offset_romfs + GetRomFsLvOffset(&ivfc, 3),
+                lvl3_size, 1 << ivfc.log_lvl3);
+
+        // lvl1 directly follows lvl3, lvl2 directly follows lvl1, both are read in one go
+        if (!ver_romfs) {
+            u64 offset_add = offset_romfs + GetRomFsLvOffset(&ivfc, 1);
+            if (((fvx_tell(&file) != offset + offset_add) && (fvx_lseek(&file, offset + offset_add) != FR_OK)) ||
+                (fvx_read(&file, lvl12_data, lvl1_size + lvl2_size, &btr) != FR_OK) ||
+                (DecryptNcch(lvl12_data, offset_add, lvl1_size + lvl2_size, &ncch, NULL) != 0))
+                ver_romfs = 1;
+            ctx.done += lvl1_size + lvl2_size;
         }
 
+        // verify lvl1, lvl2 and lvl3 hashes in memory
+        u8* lvl1_data = lvl12_data;
+        u8* lvl2_data = lvl12_data + lvl1_size;
+        for (u32 i = 0; !ver_romfs && (i < (lvl1_size >> ivfc.log_lvl1)); i++)
+            ver_romfs = (u32) sha_cmp(masterhash + (i*0x20), lvl1_data + (i<<ivfc.log_lvl1), 1<<ivfc.log_lvl1, SHA256_MODE);
+        for (u32 i = 0; !ver_romfs && (i < (lvl2_size >> ivfc.log_lvl2)); i++)
+            ver_romfs = (u32) sha_cmp(lvl1_data + (i*0x20), lvl2_data + (i<<ivfc.log_lvl2), 1<<ivfc.log_lvl2, SHA256_MODE);
+        if (!ver_romfs && (((lvl3_size >> ivfc.log_lvl3) * 0x20 > lvl2_size) ||
+            (memcmp(lvl2_data, lvl3_hashes, (lvl3_size >> ivfc.log_lvl3) * 0x20) != 0)))
+            ver_romfs = 1;
+
         if (masterhash) free(masterhash);
-        if (lvl1_data) free(lvl1_data);
-        if (lvl2_data) free(lvl2_data);
+        if (lvl3_hashes) free(lvl3_hashes);
+        if (lvl12_data) free(lvl12_data);
+        canceled = (ver_romfs == NCCH_VERIFY_CANCELED);
+    }
+
+    free(buffer);
+    if (canceled) {
+        fvx_close(&file);
+        return 1;
     }
 
     if (!offset && (ver_exthdr|ver_exefs|ver_romfs)) { // verification summary
@@ -1376,14 +1416,22 @@ u32 CryptNcchNcsdBossFirmFile(const char* orig, const char* dest, u32 mode, u16
     u32 ret = 0;
     if (!ShowProgress(offset, fsize, dest)) ret = 1;
     if (mode & (GAME_NCCH|GAME_NCSD|GAME_BOSS|SYS_FIRM|GAME_NDS)) { // for NCCH / NCSD / BOSS / FIRM files
+        NcchStreamCtx ncch_ctx;
+        NcsdStreamCtx ncsd_ctx;
+        BossStreamCtx boss_ctx;
+        FirmStreamCtx firm_ctx;
+        InitNcchStream(&ncch_ctx, NULL, NULL);
+        InitNcsdStream(&ncsd_ctx);
+        InitBossStream(&boss_ctx);
+        InitFirmStream(&firm_ctx);
         for (u64 i = 0; (i < size) && (ret == 0); i += STD_BUFFER_SIZE) {
             u32 read_bytes = min(STD_BUFFER_SIZE, (size - i));
             UINT bytes_read, bytes_written;
             if (fvx_read(ofp, buffer, read_bytes, &bytes_read) != FR_OK) ret = 1;
-            if (((mode & GAME_NCCH) && (CryptNcchSequential(buffer, i, read_bytes, crypto) != 0)) ||
-                ((mode & GAME_NCSD) && (CryptNcsdSequential(buffer, i, read_bytes, crypto) != 0)) ||
-                ((mode & GAME_BOSS) && crypt_boss && (CryptBossSequential(buffer, i, read_bytes) != 0)) ||
-                ((mode & SYS_FIRM) && (DecryptFirmSequential(buffer, i, read_bytes) != 0)))
+            if (((mode & GAME_NCCH) && (CryptNcchStream(&ncch_ctx, buffer, i, read_bytes, crypto) != 0)) ||
+                ((mode & GAME_NCSD) && (CryptNcsdStream(&ncsd_ctx, buffer, i, read_bytes, crypto) != 0)) ||
+                ((mode & GAME_BOSS) && crypt_boss && (CryptBossStream(&boss_ctx, buffer, i, read_bytes) != 0)) ||
+                ((mode & SYS_FIRM) && (DecryptFirmStream(&firm_ctx, buffer, i, read_bytes) != 0)))
                 ret = 1;
             if (inplace) fvx_lseek(ofp, fvx_tell(ofp) - read_bytes);
             if (fvx_write(dfp, buffer, read_bytes, &bytes_written) != FR_OK) ret = 1;
@@ -1404,6 +1452,8 @@ u32 CryptNcchNcsdBossFirmFile(const char* orig, const char* dest, u32 mode, u16
         if (ncch_crypto && (SetupNcchCrypto(ncch, crypto) != 0))
             ret = 1;
 
+        NcchStreamCtx ncch_ctx;
+        InitNcchStream(&ncch_ctx, NULL, NULL);
         GetTmdCtr(ctr, chunk);
         fvx_lseek(ofp, offset);
         sha_init(SHA256_MODE);
@@ -1411,7 +1461,7 @@ u32 CryptNcchNcsdBossFirmFile(const char* orig, const char* dest, u32 mode, u16
             u32 read_bytes = min(STD_BUFFER_SIZE, (size - i));
             if (fvx_read(ofp, buffer, read_bytes, &bytes_read) != FR_OK) ret = 1;
             if (cia_crypto && (DecryptCiaContentSequential(buffer, read_bytes, ctr, titlekey) != 0)) ret = 1;
-            if (ncch_crypto && (CryptNcchSequential(buffer, i, read_bytes, crypto) != 0)) ret = 1;
+            if (ncch_crypto && (CryptNcchStream(&ncch_ctx, buffer, i, read_bytes, crypto) != 0)) ret = 1;
             if (inplace) fvx_lseek(ofp, fvx_tell(ofp) - read_bytes);
             if (fvx_write(dfp, buffer, read_bytes, &bytes_written) != FR_OK) ret = 1;
             sha_update(buffer, read_bytes);
@@ -1780,6 +1830,117 @@ u32 CreateSaveData(const char* drv, u64 tid64, const char* name, u32 save_size,
     return 0;
 }
 
+// title.db / ticket.db change queued while a database batch is open
+typedef struct {
+    char path_db[32];
+    bool tickdb;
+    bool done;
+    u32 item; // see SetDbBatchItem()
+    BDRIBatchEntry bdri; // entry is an owned copy
+} DbBatchOp;
+
+static DbBatchOp* db_batch = NULL;
+static u32 db_batch_n = 0;
+static u32 db_batch_max = 0;
+static u32 db_batch_depth = 0;
+static u32 db_batch_item = 0;
+
+void BeginDbBatch(void) {
+    if (!db_batch_depth++) db_batch_item = 0;
+}
+
+// changes queued from here on belong to this item (f.e. the index of the file being installed)
+void SetDbBatchItem(u32 item) {
+    db_batch_item = item;
+}
+
+static u32 QueueDbChange(const char* path_db, bool tickdb, const u8* title_id, const void* entry, u32 size) {
+    if (!db_batch_depth) return 1;
+
+    if (db_batch_n >= db_batch_max) {
+        u32 max_new = db_batch_max ? db_batch_max * 2 : 16;
+        DbBatchOp* batch_new = (DbBatchOp*) realloc(db_batch, max_new * sizeof(DbBatchOp));
+        if (!batch_new) return 1;
+        db_batch = batch_new;
+        db_batch_max = max_new;
+    }
+
+    DbBatchOp* op = db_batch + db_batch_n;
+    memset(op, 0, sizeof(DbBatchOp));
+    strncpy(op->path_db, path_db, 31);
+    op->tickdb = tickdb;
+    op->item = db_batch_item;
+    memcpy(op->bdri.title_id, title_id, 8);
+    if (entry) {
+        void* copy = malloc(size);
+        if (!copy) return 1;
+        memcpy(copy, entry, size);
+        op->bdri.entry = copy;
+    }
+
+    db_batch_n++;
+    return 0;
+}
+
+// item_ok (optional, n_items entries) is cleared for every item with a failed change
+u32 CommitDbBatch(bool* item_ok, u32 n_items) {
+    // only the outermost commit writes anything
+    if (!db_batch_depth || --db_batch_depth) return 0;
+    if (!db_batch_n) return 0;
+
+    BDRIBatchEntry* bdri = (BDRIBatchEntry*) malloc(db_batch_n * sizeof(BDRIBatchEntry));
+
+    // ensure remounting the old mount path
+    char path_store[256] = { 0 };
+    char* path_bak = NULL;
+    strncpy(path_store, GetMountPath(), 256);
+    if (*path_store) path_bak = path_store;
+
+    // one mount (and one hash / CMAC fix) per database, order within a database is kept
+    for (u32 i = 0; bdri && (i < db_batch_n); i++) {
+        if (db_batch[i].done) continue;
+
+        u32 n_bdri = 0;
+        for (u32 j = i; j < db_batch_n; j++) {
+            if (strncmp(db_batch[j].path_db, db_batch[i].path_db, 32) != 0) continue;
+            memcpy(bdri + n_bdri++, &(db_batch[j].bdri), sizeof(BDRIBatchEntry));
+        }
+
+        if (!InitImgFS(db_batch[i].path_db)) {
+            for (u32 j = 0; j < n_bdri; j++)
+                bdri[j].result = 1;
+        } else ApplyBatchToDB(PART_PATH, db_batch[i].tickdb, bdri, n_bdri);
+
+        n_bdri = 0;
+        for (u32 j = i; j < db_batch_n; j++) {
+            if (strncmp(db_batch[j].path_db, db_batch[i].path_db, 32) != 0) continue;
+            db_batch[j].bdri.result = bdri[n_bdri++].result;
+            db_batch[j].done = true;
+        }
+    }
+
+    // restore old mount path
+    InitImgFS(path_bak);
+
+    // report failed changes per item
+    u32 ret = 0;
+    for (u32 i = 0; i < db_batch_n; i++) {
+        if (db_batch[i].done && !db_batch[i].bdri.result) continue;
+        if (item_ok && (db_batch[i].item < n_items)) item_ok[db_batch[i].item] = false;
+        ret = 1;
+    }
+
+    for (u32 i = 0; i < db_batch_n; i++)
+        free((void*) db_batch[i].bdri.entry);
+    free(db_batch);
+    free(bdri);
+    db_batch = NULL;
+    db_batch_n = 0;
+    db_batch_max = 0;
+
+    return ret;
+}
+
 u32 UninstallGameData(const char *drv, u64 tid64, bool remove_tie, bool remove_ticket, bool remove_save) {
     // check permissions for SysNAND (this includes everything we need)
     if (!CheckWritePermissions(drv)) return 1;
@@ -1799,7 +1960,17 @@ u32 UninstallGameData(const char *drv, u64 tid64, bool remove_tie, bool remove_t
 
     // remove titledb entry / ticket
     u32 ret = 0;
-    if (remove_tie || remove_ticket) {
+    if ((remove_tie || remove_ticket) && db_batch_depth) {
+        // queue for the open database batch
+        char path_db[32];
+        u8 title_id[8];
+        for (u32 i = 0; i < 8; i++)
+            title_id[i] = (tid64 >> ((7-i)*8)) & 0xFF;
+        if (remove_ticket && ((GetInstallDbsPath(path_db, drv, "ticket.db") != 0) ||
+            (QueueDbChange(path_db, true, title_id, NULL, 0) != 0))) ret = 1;
+        if (remove_tie && ((GetInstallDbsPath(path_db, drv, "title.db") != 0) ||
+            (QueueDbChange(path_db, false, title_id, NULL, 0) != 0))) ret = 1;
+    } else if (remove_tie || remove_ticket) {
         // ensure remounting the old mount path
         char path_store[256] = { 0 };
         char* path_bak = NULL;
@@ -1989,6 +2160,43 @@ u32 LoadEncryptedIconFromCiaTmd(const char* path, void* output, void* hdr, bool
     return ret;
 }
 
+// content de- / encryption and hashing, all stages run on one slice before the next
+// slice is touched; every stage redoes its key / CTR setup per slice, so slices are
+// kept large (4 setups per MB and stage instead of 256 with 4KB slices)
+#define CONTENT_SLICE_SIZE  0x40000 // multiple of 0x200, at least 0x600 (see SetNcchSdFlag())
+
+typedef struct {
+    u8 ctr_in[16];
+    u8 ctr_out[16];
+    const u8* titlekey;
+    NcchStreamCtx* ncch_ctx; // NULL for no NCCH decryption
+    bool cia_decrypt;
+    bool cia_encrypt;
+    bool cxi_fix;
+} CiaContentStream;
+
+static void InitCiaContentStream(CiaContentStream* stream, TmdContentChunk* chunk, const u8* titlekey) {
+    memset(stream, 0x00, sizeof(CiaContentStream));
+    GetTmdCtr(stream->ctr_in, chunk);
+    GetTmdCtr(stream->ctr_out, chunk);
+    stream->titlekey = titlekey;
+}
+
+static u32 ProcessCiaContentStream(CiaContentStream* stream, u8* data, u32 offset, u32 size) {
+    for (u32 i = 0; i < size; i += CONTENT_SLICE_SIZE) {
+        u8* slice = data + i;
+        u32 pos = offset + i;
+        u32 slice_size = min(CONTENT_SLICE_SIZE, size - i);
+        if (stream->cia_decrypt && (DecryptCiaContentSequential(slice, slice_size, stream->ctr_in, stream->titlekey) != 0)) return 1;
+        if (stream->ncch_ctx && (DecryptNcchStream(stream->ncch_ctx, slice, pos, slice_size) != 0)) return 1;
+        if ((pos == 0) && stream->cxi_fix && (SetNcchSdFlag(slice) != 0)) return 1;
+        if (pos == 0) sha_init(SHA256_MODE);
+        sha_update(slice, slice_size);
+        if (stream->cia_encrypt && (EncryptCiaContentSequential(slice, slice_size, stream->ctr_out, stream->titlekey) != 0)) return 1;
+    }
+    return 0;
+}
+
 u32 InstallCiaContent(const char* drv, const char* path_content, u32 offset, u32 size,
     TmdContentChunk* chunk, const u8* title_id, const u8* titlekey, bool cxi_fix, bool cdn_decrypt) {
     char dest[256];
@@ -2033,20 +2241,16 @@ u32 InstallCiaContent(const char* drv, const char* path_content, u32 offset, u32
     }
 
     // main loop starts here
-    u8 ctr_in[16];
-    u8 ctr_out[16];
+    CiaContentStream stream;
     u32 ret = 0;
-    bool cia_crypto = getbe16(chunk->type) & 0x1;
-    GetTmdCtr(ctr_in, chunk);
-    GetTmdCtr(ctr_out, chunk);
+    InitCiaContentStream(&stream, chunk, titlekey);
+    stream.cia_decrypt = (getbe16(chunk->type) & 0x1) || cdn_decrypt;
+    stream.cxi_fix = cxi_fix;
     if (!ShowProgress(0, 0, path_content)) ret = 1;
     for (u32 i = 0; (i < size) && (ret == 0); i += STD_BUFFER_SIZE) {
         u32 read_bytes = min(STD_BUFFER_SIZE, (size - i));
         if (fvx_read(&ofile, buffer, read_bytes, &bytes_read) != FR_OK) ret = 1;
-        if ((cia_crypto || cdn_decrypt) && (DecryptCiaContentSequential(buffer, read_bytes, ctr_in, titlekey) != 0)) ret = 1;
-        if ((i == 0) && cxi_fix && (SetNcchSdFlag(buffer) != 0)) ret = 1;
-        if (i == 0) sha_init(SHA256_MODE);
-        sha_update(buffer, read_bytes);
+        if (ProcessCiaContentStream(&stream, buffer, i, read_bytes) != 0) ret = 1;
         if (fvx_write(&dfile, buffer, read_bytes, &bytes_written) != FR_OK) ret = 1;
         if ((read_bytes != bytes_read) || (bytes_read != bytes_written)) ret = 1;
         if (!ShowProgress(offset + i + read_bytes, fsize, path_content)) ret = 1;
@@ -2162,32 +2366,14 @@ u32 InstallCiaSystemData(CiaStub* cia, const char* drv) {
         return 1;
 
     // write ticket and title databases
-    // ensure remounting the old mount path
-    char path_store[256] = { 0 };
-    char* path_bak = NULL;
-    strncpy(path_store, GetMountPath(), 256);
-    if (*path_store) path_bak = path_store;
-
-    // title database
-    if (!InitImgFS(path_titledb) ||
-        (AddTitleInfoEntryToDB(PART_PATH, title_id, &tie, true) != 0)) {
-        InitImgFS(path_bak);
+    // (deferred to the outermost batch commit if one is open)
+    u32 ret = 0;
+    BeginDbBatch();
+    if ((QueueDbChange(path_titledb, false, title_id, &tie, sizeof(TitleInfoEntry)) != 0) ||
+        (QueueDbChange(path_ticketdb, true, title_id, ticket, GetTicketSize((Ticket*) ticket)) != 0))
+        ret = 1;
+    if ((CommitDbBatch(NULL, 0) != 0) || (ret != 0))
         return 1;
-    }
-
-    // ticket database
-    if (!InitImgFS(path_ticketdb) ||
-        (AddTicketToDB(PART_PATH, title_id, (Ticket*) ticket, true) != 0)) {
-        // workaround for bug #685
-        RemoveTicketFromDB(PART_PATH, title_id);
-        if (AddTicketToDB(PART_PATH, title_id, (Ticket*) ticket, true) != 0) {
-            InitImgFS(path_bak);
-            return 1;
-        }
-    }
-
-    // restore old mount path
-    InitImgFS(path_bak);
 
     // fix CMACs where required
     if (!syscmd) FixFileCmac(path_cmd, true);
@@ -2229,6 +2415,8 @@ u32 InsertCiaContent(const char* path_cia, const char* path_content, u32 offset,
     }
 
     // check if NCCH crypto is available
+    NcchStreamCtx ncch_ctx;
+    InitNcchStream(&ncch_ctx, NULL, NULL);
     if (ncch_decrypt) {
         NcchHeader ncch;
         u8 ctr[16];
@@ -2250,21 +2438,18 @@ u32 InsertCiaContent(const char* path_cia, const char* path_content, u32 offset,
     }
 
     // main loop starts here
-    u8 ctr_in[16];
-    u8 ctr_out[16];
+    CiaContentStream stream;
     u32 ret = 0;
-    GetTmdCtr(ctr_in, chunk);
-    GetTmdCtr(ctr_out, chunk);
+    InitCiaContentStream(&stream, chunk, titlekey);
+    stream.cia_decrypt = cdn_decrypt;
+    stream.ncch_ctx = ncch_decrypt ? &ncch_ctx : NULL;
+    stream.cxi_fix = cxi_fix;
+    stream.cia_encrypt = cia_encrypt;
     if (!ShowProgress(0, 0, path_content)) ret = 1;
     for (u32 i = 0; (i < size) && (ret == 0); i += STD_BUFFER_SIZE) {
         u32 read_bytes = min(STD_BUFFER_SIZE, (size - i));
         if (fvx_read(&ofile, buffer, read_bytes, &bytes_read) != FR_OK) ret = 2;
-        if (cdn_decrypt && (DecryptCiaContentSequential(buffer, read_bytes, ctr_in, titlekey) != 0)) ret = 1;
-        if (ncch_decrypt && (DecryptNcchSequential(buffer, i, read_bytes) != 0)) ret = 1;
-        if ((i == 0) && cxi_fix && (SetNcchSdFlag(buffer) != 0)) ret = 1;
-        if (i == 0) sha_init(SHA256_MODE);
-        sha_update(buffer, read_bytes);
-        if (cia_encrypt && (EncryptCiaContentSequential(buffer, read_bytes, ctr_out, titlekey) != 0)) ret = 1;
+        if (ProcessCiaContentStream(&stream, buffer, i, read_bytes) != 0) ret = 1;
         if (fvx_write(&dfile, buffer, read_bytes, &bytes_written) != FR_OK) ret = 1;
         if ((read_bytes != bytes_read) || (bytes_read != bytes_written)) ret = 1;
         if (!ShowProgress(offset + i + read_bytes, fsize, path_content)) ret = 1;
@@ -3229,25 +3414,15 @@ u32 InstallTicketFile(const char* path, bool to_emunand) {
     ShowString("%s\n%s\n", pathstr, STR_INSTALLING_TICKET);
 
     // write ticket database
-    // ensure remounting the old mount path
-    char path_store[256] = { 0 };
-    char* path_bak = NULL;
-    strncpy(path_store, GetMountPath(), 256);
-    if (*path_store) path_bak = path_store;
-
-    // ticket database
-    if (!InitImgFS(path_ticketdb) ||
-        ((AddTicketToDB(PART_PATH, ticket->title_id, (Ticket*) ticket, true)) != 0)) {
-        InitImgFS(path_bak);
-        free(ticket);
-        return 1;
-    }
-
-    // restore old mount path
-    InitImgFS(path_bak);
+    // (deferred to the outermost batch commit if one is open)
+    u32 ret = 0;
+    BeginDbBatch();
+    if (QueueDbChange(path_ticketdb, true, ticket->title_id, ticket, GetTicketSize(ticket)) != 0)
+        ret = 1;
+    if (CommitDbBatch(NULL, 0) != 0) ret = 1;
 
     free(ticket);
-    return 0;
+    return ret;
 }
 
 u32 DumpTicketForGameFile(const char* path, bool force_legit) {
@@ -4049,26 +4224,23 @@ u32 BuildTitleKeyInfo(const char* path, bool dec, bool dump) {
         u32 num_entries = 0;
         u8* title_ids = NULL;
 
-        if (!InitImgFS(path_in) ||
-            !(num_entries = GetNumTickets(PART_PATH)) ||
+        if (!(num_entries = GetNumTickets(path_in)) ||
             !(title_ids = (u8*) malloc(num_entries * 8)) ||
-            (ListTicketTitleIDs(PART_PATH, title_ids, num_entries) != 0)) {
+            (ListTicketTitleIDs(path_in, title_ids, num_entries) != 0)) {
             free(title_ids);
-            InitImgFS(NULL);
             return 1;
         }
 
         // read and validate all tickets, add validated to info
         for (u32 i = 0; i < num_entries; i++) {
             Ticket* ticket;
-            if (ReadTicketFromDB(PART_PATH, title_ids + (i * 8), &ticket) != 0) continue;
+            if (ReadTicketFromDB(path_in, title_ids + (i * 8), &ticket) != 0) continue;
             if (ValidateTicketSignature(ticket) == 0)
                 AddTicketToInfo(tik_info, ticket, dec); // ignore result
             free(ticket);
         }
 
         free(title_ids);
-        InitImgFS(NULL);
     } else if (filetype & BIN_TIKDB) {
         TitleKeysInfo* tik_info_merge = (TitleKeysInfo*) malloc(STD_BUFFER_SIZE);
         if (!tik_info_merge) return 1;
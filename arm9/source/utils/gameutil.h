@@ -18,6 +18,9 @@ u32 TrimGameFile(const char* path);
 u32 ShowGameFileIcon(const char* path, u16* screen);
 u32 ShowGameCheckerInfo(const char* path);
 u64 GetGameFileTitleId(const char* path);
+void BeginDbBatch(void);
+void SetDbBatchItem(u32 item);
+u32 CommitDbBatch(bool* item_ok, u32 n_items);
 u32 UninstallGameDataTie(const char* path, bool remove_tie, bool remove_ticket, bool remove_save);
 u32 GetTmdContentPath(char* path_content, const char* path_tmd);
 u32 GetTieContentPath(char* path_content, const char* path_tie);
@@ -480,7 +480,7 @@ u32 SafeRestoreNandDump(const char* path) {
         for (u32 s = sector0; (s < sector1) && (ret == 0); s += STD_BUFFER_SIZE / 0x200) {
             u32 count = min(STD_BUFFER_SIZE / 0x200, (sector1 - s));
             if (ReadNandFile(&file, buffer, s, count, 0xFF)) ret = 1;
-            if (WriteNandSectors(buffer, s, count, 0xFF, NAND_SYSNAND)) ret = 1;
+            if (WriteNandSectorsInPlace(buffer, s, count, 0xFF, NAND_SYSNAND)) ret = 1;
             if (!ShowProgress(s + count, fsize / 0x200, path)) ret = 1;
         }
         if (sector1 == fsize / 0x200) break; // at file end
@@ -558,7 +558,7 @@ u32 SafeInstallFirmBuffered(const char* path, u32 slots, u8* buffer, u32 bufsiz)
 
     // point of no return
     ShowString("%s", STR_INSTALLING_FIRM_PLEASE_WAIT);
-    if (fix_sector0x96 && (WriteNandSectors(sector0x96, 0x96, 1, 0x11, NAND_SYSNAND) != 0)) {
+    if (fix_sector0x96 && (WriteNandSectorsInPlace(sector0x96, 0x96, 1, 0x11, NAND_SYSNAND) != 0)) {
         ShowPrompt(false, "%s", STR_THIS_IS_BAD_FAILED_WRITING_SECTOR_0X96_TRY_FIX_BEFORE_REBOOT);
         return 1;
     }
@@ -27,6 +27,7 @@
 #define _VAR_CNT_LEN    256
 #define _VAR_NAME_LEN   32
 #define _VAR_MAX_BUFF   256
+#define _VAR_HASH_SIZE  512 // power of two, larger than _VAR_MAX_BUFF
 #define _ERR_STR_LEN    256
 
 #define _CHOICE_STR_LEN 32
@@ -145,6 +146,13 @@ typedef struct {
     char content[_VAR_CNT_LEN];
 } Gm9ScriptVar;
 
+typedef struct {
+    char* line; // start of the label line
+    char* name; // label name, without '@'
+    u32 name_len;
+    bool valid; // nothing but a comment after the label
+} Gm9ScriptLabel;
+
 static const Gm9ScriptCmd cmd_list[] = {
     { CMD_ID_NONE    , "#"       , 0, 0 }, // dummy entry
     { CMD_ID_NOT     , _CMD_NOT  , 0, 0 }, // inverts the output of the following command
@@ -229,6 +237,13 @@ static u32 ifcnt = 0;               // current # of 'if' nesting
 static void* script_buffer = NULL;
 static void* var_buffer = NULL;
 
+// var lookup table (var index + 1, zero is empty) and reachable labels, built once per script
+static u16 var_hash[_VAR_HASH_SIZE];
+static u32 var_count = 0;
+static Gm9ScriptLabel* label_list = NULL;
+static u32 label_count = 0;
+static bool labels_indexed = false;
+
 
 static inline bool isntrboot(void) {
     // taken over from Luma 3DS:
@@ -419,6 +434,27 @@ void set_preview(const char* name, const char* content) {
     }
 }
 
+static inline u32 var_name_hash(const char* name) {
+    u32 hash = 0x811C9DC5; // FNV-1a
+    for (u32 i = 0; (i < _VAR_NAME_LEN) && name[i]; i++)
+        hash = (hash ^ (u8) name[i]) * 0x01000193;
+    return hash;
+}
+
+// hash table slot holding the var with this name, or the empty slot it would go to
+static u16* find_var_slot(const char* name) {
+    Gm9ScriptVar* vars = (Gm9ScriptVar*) var_buffer;
+    u32 hash = var_name_hash(name);
+
+    for (u32 i = 0; i < _VAR_HASH_SIZE; i++) {
+        u16* slot = &(var_hash[(hash + i) & (_VAR_HASH_SIZE - 1)]);
+        if (!*slot || (strncmp(vars[*slot - 1].name, name, _VAR_NAME_LEN) == 0))
+            return slot;
+    }
+
+    return NULL; // can't happen, table never gets full
+}
+
 char* set_var(const char* name, const char* content) {
     Gm9ScriptVar* vars = (Gm9ScriptVar*) var_buffer;
 
@@ -426,15 +462,19 @@ char* set_var(const char* name, const char* content) {
         (strchr(name, '[') || strchr(name, ']')))
         return NULL;
 
-    u32 n_var = 0;
-    for (Gm9ScriptVar* var = vars; n_var < _VAR_MAX_BUFF; n_var++, var++)
-        if (!*(var->name) || (strncmp(var->name, name, _VAR_NAME_LEN) == 0)) break;
+    u16* slot = find_var_slot(name);
+    if (!slot) return NULL;
+    u32 n_var = (*slot) ? (u32) *slot - 1 : var_count;
     if (n_var >= _VAR_MAX_BUFF) return NULL;
     strncpy(vars[n_var].name, name, _VAR_NAME_LEN);
     vars[n_var].name[_VAR_NAME_LEN - 1] = '\0';
     strncpy(vars[n_var].content, content, _VAR_CNT_LEN);
     vars[n_var].content[_VAR_CNT_LEN - 1] = '\0';
     if (!n_var) *(vars[n_var].content) = '\0'; // NULL var
+    if (!*slot) {
+        *slot = n_var + 1;
+        var_count++;
+    }
 
     // update preview stuff
     set_preview(name, content);
@@ -544,12 +584,8 @@ char* get_var(const char* name, char** endptr) {
     vname[name_len] = '\0';
     upd_var(vname); // handle dynamic env vars
 
-    u32 n_var = 0;
-    for (Gm9ScriptVar* var = vars; n_var < _VAR_MAX_BUFF; n_var++, var++) {
-        if (!*(var->name) || (strncmp(var->name, vname, _VAR_NAME_LEN) == 0)) break;
-    }
-
-    if (n_var >= _VAR_MAX_BUFF || !*(vars[n_var].name)) n_var = 0;
+    u16* slot = find_var_slot(vname);
+    u32 n_var = (slot && *slot) ? (u32) *slot - 1 : 0; // not found -> NULL var
 
     return vars[n_var].content;
 }
@@ -557,6 +593,8 @@ char* get_var(const char* name, char** endptr) {
 bool init_vars(const char* path_script) {
     // reset var buffer
     memset(var_buffer, 0x00, sizeof(Gm9ScriptVar) * _VAR_MAX_BUFF);
+    memset(var_hash, 0x00, sizeof(var_hash));
+    var_count = 0;
 
     // current path
     char curr_dir[_VAR_CNT_LEN];
@@ -767,17 +805,13 @@ char* find_next(char* ptr) {
     return NULL;
 }
 
-char* find_label(const char* label, const char* last_found) {
+// list all labels reachable by 'goto' / 'labelsel' (not inside 'if' or 'for' blocks)
+bool index_labels(void) {
     char* script = (char*) script_buffer;
     char* ptr = script;
-    u32 label_len = strnlen(label, _ARG_MAX_LEN);
-
-    if (last_found) {
-        ptr = strchr(last_found, '\n');
-        if (!ptr) return NULL;
-        ptr++;
-    }
+    u32 label_max = 0;
 
+    label_count = 0;
     char* next = ptr;
     for (; next && *ptr; ptr = next) {
         // store line start / get line end
@@ -793,20 +827,20 @@ char* find_label(const char* label, const char* last_found) {
         else if (str >= line_end) continue; // empty line
 
         if (*str == '@') {
-            // label found
-            str++; STR_SCRIPTERR_len--;
-
-            // compare it manually (also check for '*' at end)
-            u32 pdiff = 0;
-            for (; (pdiff < STR_SCRIPTERR_len) && (label[pdiff] == str[pdiff]); pdiff++);
-            if ((pdiff < label_len) && (label[pdiff] != '*')) continue; // no match
-            // otherwise: potential regular or wildcard match
-
-            // may be a match, see if there are more strings after it
-            if (!(str = get_string(ptr, line_end, &STR_SCRIPTERR_len, &ptr, NULL))) continue; // string error, ignore line
-            else if ((str < line_end) && (*str != '#')) continue; // neither end of line nor comment
+            if (label_count >= label_max) {
+                label_max = label_max ? label_max * 2 : 64;
+                Gm9ScriptLabel* list = (Gm9ScriptLabel*) realloc(label_list, label_max * sizeof(Gm9ScriptLabel));
+                if (!list) return false;
+                label_list = list;
+            }
 
-            return line_start; // match found
+            // label found, see if there are more strings after it
+            Gm9ScriptLabel* label = &(label_list[label_count++]);
+            label->line = line_start;
+            label->name = str + 1;
+            label->name_len = STR_SCRIPTERR_len - 1;
+            str = get_string(ptr, line_end, &STR_SCRIPTERR_len, &ptr, NULL);
+            label->valid = str && ((str >= line_end) || (*str == '#')); // end of line or comment
         } else if (MATCH_STR(str, STR_SCRIPTERR_len, _CMD_IF)) {
             next = skip_block(line_start, true, true);
         } else if (MATCH_STR(str, STR_SCRIPTERR_len, _CMD_FOR)) {
@@ -814,6 +848,28 @@ char* find_label(const char* label, const char* last_found) {
         } // otherwise: irrelevant line
     }
 
+    return true;
+}
+
+char* find_label(const char* label, const char* last_found) {
+    u32 label_len = strnlen(label, _ARG_MAX_LEN);
+
+    // script doesn't change, labels are only indexed once
+    if (!labels_indexed && !(labels_indexed = index_labels()))
+        return NULL;
+
+    for (u32 i = 0; i < label_count; i++) {
+        Gm9ScriptLabel* entry = &(label_list[i]);
+        if (!entry->valid || (last_found && (entry->line <= last_found))) continue;
+
+        // compare it manually (also check for '*' at end)
+        u32 pdiff = 0;
+        for (; (pdiff < entry->name_len) && (label[pdiff] == entry->name[pdiff]); pdiff++);
+        if ((pdiff < label_len) && (label[pdiff] != '*')) continue; // no match
+
+        return entry->line; // match found
+    }
+
     return NULL;
 }
 
@@ -2283,6 +2339,7 @@ bool ExecuteGM9Script(const char* path_script) {
     for_ptr = NULL;
     skip_state = 0;
     syntax_error = false;
+    labels_indexed = false;
 
 
     // allocate && check memory
@@ -2482,5 +2539,8 @@ bool ExecuteGM9Script(const char* path_script) {
 
     free(var_buffer);
     free(script_buffer);
+    free(label_list);
+    label_list = NULL;
+    label_count = 0;
     return result;
 }
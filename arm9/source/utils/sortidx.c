@@ -0,0 +1,96 @@
+#include "sortidx.h"
+#include "vff.h"
+
+
+static int CompareSortedIndexKey(SortedIndex* idx, const void* key0, const void* key1) {
+    return idx->compare ? idx->compare(key0, key1) : memcmp(key0, key1, idx->key_size);
+}
+
+// binary search; returns the insert position if not found
+static u32 FindSortedIndexPos(SortedIndex* idx, const void* key, bool* found) {
+    u32 lo = 0;
+    u32 hi = idx->n_entries;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        int cmp = CompareSortedIndexKey(idx, idx->entries + (mid * idx->entry_size), key);
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        } else if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *found = false;
+    return lo;
+}
+
+// path may be NULL for an index that only lives in memory
+u32 OpenSortedIndex(SortedIndex* idx, const char* path) {
+    CloseSortedIndex(idx, NULL);
+
+    idx->entries = (u8*) malloc(idx->max_entries * idx->entry_size);
+    if (!idx->entries) return 1;
+    if (!path) return 0;
+
+    // a missing or broken file just means starting from scratch
+    UINT btr = 0;
+    u32 fsize = fvx_qsize(path);
+    if (fsize && !(fsize % idx->entry_size) && (fsize <= idx->max_entries * idx->entry_size) &&
+        (fvx_qread(path, idx->entries, 0, fsize, &btr) == FR_OK) && (btr == fsize))
+        idx->n_entries = fsize / idx->entry_size;
+
+    // drop everything if not properly sorted or not valid
+    for (u32 i = 0; i < idx->n_entries; i++) {
+        u8* entry = idx->entries + (i * idx->entry_size);
+        if ((i && (CompareSortedIndexKey(idx, entry - idx->entry_size, entry) >= 0)) ||
+            (idx->validate && !idx->validate(entry))) {
+            idx->n_entries = 0;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+// changes are only written back if path is not NULL
+u32 CloseSortedIndex(SortedIndex* idx, const char* path) {
+    u32 ret = 0;
+    if (!idx->entries) return 0;
+
+    if (path && idx->changed) {
+        fvx_rmkdir(OUTPUT_PATH);
+        fvx_unlink(path);
+        if (fvx_qwrite(path, idx->entries, 0, idx->n_entries * idx->entry_size, NULL) != FR_OK)
+            ret = 1;
+    }
+
+    free(idx->entries);
+    idx->entries = NULL;
+    idx->n_entries = 0;
+    idx->changed = false;
+    return ret;
+}
+
+void* FindSortedIndexEntry(SortedIndex* idx, const void* key) {
+    bool found = false;
+    if (!idx->entries) return NULL;
+    u32 pos = FindSortedIndexPos(idx, key, &found);
+    return found ? idx->entries + (pos * idx->entry_size) : NULL;
+}
+
+// replaces the entry with the same key, or inserts it at its sorted position
+u32 WriteSortedIndexEntry(SortedIndex* idx, const void* entry) {
+    bool found = false;
+    if (!idx->entries) return 1;
+
+    u32 pos = FindSortedIndexPos(idx, entry, &found);
+    u8* dest = idx->entries + (pos * idx->entry_size);
+    if (!found) {
+        if (idx->n_entries >= idx->max_entries) return 1; // index full
+        memmove(dest + idx->entry_size, dest, (idx->n_entries - pos) * idx->entry_size);
+        idx->n_entries++;
+    }
+    memcpy(dest, entry, idx->entry_size);
+    idx->changed = true;
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common.h"
+
+// fixed size records, kept sorted by a key at the start of each record
+typedef struct {
+    u8*  entries;
+    u32  n_entries;
+    u32  max_entries;
+    u32  entry_size;
+    u32  key_size;
+    int  (*compare)(const void* key0, const void* key1); // memcmp() over key_size if NULL
+    bool (*validate)(const void* entry); // optional, only for entries loaded from file
+    bool changed;
+} SortedIndex;
+
+u32 OpenSortedIndex(SortedIndex* idx, const char* path);
+u32 CloseSortedIndex(SortedIndex* idx, const char* path);
+void* FindSortedIndexEntry(SortedIndex* idx, const void* key);
+u32 WriteSortedIndexEntry(SortedIndex* idx, const void* entry);
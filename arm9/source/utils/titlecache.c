@@ -0,0 +1,108 @@
+#include "titlecache.h"
+#include "gameutil.h"
+#include "language.h"
+#include "image.h"
+#include "sortidx.h"
+#include "fsdrive.h"
+#include "sddata.h"
+#include "nand.h"
+#include "crc32.h"
+#include "vff.h"
+
+#define TITLECACHE_PATH         OUTPUT_PATH "/" TITLECACHE_NAME
+#define TITLECACHE_MAX_ENTRIES  (STD_BUFFER_SIZE / sizeof(TitleCacheEntry))
+#define TITLECACHE_MAGIC        0x31304354 // "TC01", rules out caches from older versions
+
+// title cache entry, identified by title id and source (title.db path + language)
+// an entry is valid as long as title version and TMD content id in title.db are unchanged
+typedef struct {
+    u64 title_id;
+    u32 source_crc;
+    u32 title_version;
+    u32 tmd_content_id;
+    u32 magic;
+    char name[128+1]; // same as GetGoodName() output
+    u8  padding[7];
+} PACKED_STRUCT TitleCacheEntry;
+
+static int CompareTitleCacheKey(const void* key0, const void* key1) {
+    const TitleCacheEntry* entry0 = (const TitleCacheEntry*) key0;
+    const TitleCacheEntry* entry1 = (const TitleCacheEntry*) key1;
+    if (entry0->title_id != entry1->title_id) return (entry0->title_id < entry1->title_id) ? -1 : 1;
+    if (entry0->source_crc != entry1->source_crc) return (entry0->source_crc < entry1->source_crc) ? -1 : 1;
+    return 0;
+}
+
+static bool ValidateTitleCacheEntry(const void* entry) {
+    const TitleCacheEntry* title = (const TitleCacheEntry*) entry;
+    return (title->magic == TITLECACHE_MAGIC) && (title->name[sizeof(title->name) - 1] == '\0');
+}
+
+static SortedIndex title_cache = {
+    .entry_size = sizeof(TitleCacheEntry),
+    .key_size = sizeof(u64) + sizeof(u32),
+    .max_entries = TITLECACHE_MAX_ENTRIES,
+    .compare = CompareTitleCacheKey,
+    .validate = ValidateTitleCacheEntry
+};
+
+
+// the same title may be installed on several NANDs / SD cards, and part of the name is translated
+// drives are told apart by their FAT volume serial, alias path (SD id0 / id1) and EmuNAND location
+static u32 GetTitleCacheSource(void) {
+    const char* mntpath = GetMountPath();
+    char fatpath[256];
+    DWORD vsn = 0;
+
+    dealias_path(fatpath, mntpath);
+    char drv[3] = { fatpath[0], ':', '\0' };
+    if (f_getlabel(drv, NULL, &vsn) != FR_OK) vsn = 0;
+    u32 emunand_base = (DriveType(mntpath) & DRV_EMUNAND) ? GetEmuNandBase() : 0;
+
+    u32 crc = crc32_calculate(0, (const u8*) fatpath, strnlen(fatpath, 256));
+    crc = crc32_calculate(crc, (const u8*) &vsn, sizeof(DWORD));
+    crc = crc32_calculate(crc, (const u8*) &emunand_base, sizeof(u32));
+    crc = crc32_calculate(crc, (const u8*) STR_DSI_ENHANCED, strlen(STR_DSI_ENHANCED));
+    crc = crc32_calculate(crc, (const u8*) STR_DSI_EXCLUSIVE, strlen(STR_DSI_EXCLUSIVE));
+    return crc;
+}
+
+u32 OpenTitleCache(void) {
+    return OpenSortedIndex(&title_cache, TITLECACHE_PATH);
+}
+
+u32 CloseTitleCache(void) {
+    return CloseSortedIndex(&title_cache, TITLECACHE_PATH);
+}
+
+// same as GetGoodName() for title.db entries, tie has to be loaded from path_tie
+u32 GetTieGoodNameCached(char* name, const char* path_tie, TitleInfoEntry* tie) {
+    TitleCacheEntry entry;
+    u64 title_id = 0;
+
+    if (!title_cache.entries || (sscanf(path_tie, "T:/%016llx", &title_id) != 1))
+        return GetGoodName(name, path_tie, false);
+
+    // unchanged since last time?
+    memset(&entry, 0x00, sizeof(TitleCacheEntry));
+    entry.title_id = title_id;
+    entry.source_crc = GetTitleCacheSource();
+    TitleCacheEntry* known = (TitleCacheEntry*) FindSortedIndexEntry(&title_cache, &entry);
+    if (known && (known->title_version == tie->title_version) && (known->tmd_content_id == tie->tmd_content_id)) {
+        strncpy(name, known->name, 128 + 1);
+        return 0;
+    }
+
+    // failures are not cached, these may be due to missing keys
+    if (GetGoodName(name, path_tie, false) != 0)
+        return 1;
+
+    // update cache (nothing happens if it is full)
+    entry.title_version = tie->title_version;
+    entry.tmd_content_id = tie->tmd_content_id;
+    entry.magic = TITLECACHE_MAGIC;
+    strncpy(entry.name, name, sizeof(entry.name) - 1);
+    WriteSortedIndexEntry(&title_cache, &entry);
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "common.h"
+#include "tie.h"
+
+#define TITLECACHE_NAME "titles.idx"
+
+u32 OpenTitleCache(void);
+u32 CloseTitleCache(void);
+u32 GetTieGoodNameCached(char* name, const char* path_tie, TitleInfoEntry* tie);
@@ -6,4 +6,7 @@
 #include "nandcmac.h"
 #include "nandutil.h"
 #include "scripting.h"
+#include "sortidx.h"
 #include "sysinfo.h"
+#include "titlecache.h"
+#include "verifyidx.h"
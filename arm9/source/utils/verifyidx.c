@@ -0,0 +1,109 @@
+#include "verifyidx.h"
+#include "gameutil.h"
+#include "virtual.h"
+#include "sortidx.h"
+#include "sha.h"
+#include "vff.h"
+
+#define VERIFYIDX_PATH          OUTPUT_PATH "/" VERIFYIDX_NAME
+#define VERIFYIDX_MAX_ENTRIES   (STD_BUFFER_SIZE / sizeof(VerifyIdxEntry))
+
+// verification index entry, files are identified by the SHA-256 of their path
+// an entry is valid as long as size and FAT timestamp are unchanged
+typedef struct {
+    u8  path_sha256[0x20];
+    u64 size;
+    u16 fdate;
+    u16 ftime;
+    u8  result; // 0 if verified okay
+    u8  sig_check;
+    u8  reserved[2];
+} PACKED_STRUCT VerifyIdxEntry;
+
+typedef struct {
+    u64 position; // drive letter / start cluster
+    u32 index;
+} DiskOrderEntry;
+
+static SortedIndex verify_idx = {
+    .entry_size = sizeof(VerifyIdxEntry),
+    .key_size = 0x20,
+    .max_entries = VERIFYIDX_MAX_ENTRIES
+};
+
+
+u32 OpenVerifyIndex(void) {
+    return OpenSortedIndex(&verify_idx, VERIFYIDX_PATH);
+}
+
+u32 CloseVerifyIndex(void) {
+    return CloseSortedIndex(&verify_idx, VERIFYIDX_PATH);
+}
+
+u32 VerifyGameFileIndexed(const char* path, bool sig_check) {
+    VerifyIdxEntry entry;
+    FILINFO fno;
+
+    // virtual files have no timestamps, these are always verified
+    if (!verify_idx.entries || GetVirtualSource(path) || (fvx_stat(path, &fno) != FR_OK))
+        return VerifyGameFile(path, sig_check);
+
+    // unchanged and known good? (failures are always retried, these may be due to missing keys)
+    memset(&entry, 0x00, sizeof(VerifyIdxEntry));
+    sha_quick(entry.path_sha256, path, strnlen(path, 256), SHA256_MODE);
+    VerifyIdxEntry* known = (VerifyIdxEntry*) FindSortedIndexEntry(&verify_idx, entry.path_sha256);
+    if (known && (known->size == fno.fsize) && (known->fdate == fno.fdate) && (known->ftime == fno.ftime) &&
+        (known->result == 0) && (known->sig_check || !sig_check)) {
+        return 0;
+    }
+
+    u32 ret = VerifyGameFile(path, sig_check);
+
+    // update index (nothing happens if it is full)
+    entry.size = fno.fsize;
+    entry.fdate = fno.fdate;
+    entry.ftime = fno.ftime;
+    entry.result = (ret == 0) ? 0 : 1;
+    entry.sig_check = sig_check ? 1 : 0;
+    WriteSortedIndexEntry(&verify_idx, &entry);
+
+    return ret;
+}
+
+static int compDiskOrderEntry(const void* e1, const void* e2) {
+    const DiskOrderEntry* entry1 = (const DiskOrderEntry*) e1;
+    const DiskOrderEntry* entry2 = (const DiskOrderEntry*) e2;
+    if (entry1->position != entry2->position)
+        return (entry1->position < entry2->position) ? -1 : 1;
+    return (entry1->index < entry2->index) ? -1 : (entry1->index > entry2->index) ? 1 : 0;
+}
+
+// get processing order for marked entries in on-disk order (by start cluster), unmarked entries go last
+u32 GetDiskOrder(u32* order, DirStruct* contents) {
+    DiskOrderEntry* disk_order = (DiskOrderEntry*) malloc(contents->n_entries * sizeof(DiskOrderEntry));
+    if (!disk_order) {
+        for (u32 i = 0; i < contents->n_entries; i++) order[i] = i;
+        return 1;
+    }
+
+    for (u32 i = 0; i < contents->n_entries; i++) {
+        DirEntry* entry = &(contents->entry[i]);
+        disk_order[i].index = i;
+        disk_order[i].position = (u64) -1;
+        if (!entry->marked || (entry->type != T_FILE)) continue;
+
+        FIL file;
+        disk_order[i].position = ((u64) (u8) entry->path[0]) << 32;
+        if (!GetVirtualSource(entry->path) && (fvx_open(&file, entry->path, FA_READ | FA_OPEN_EXISTING) == FR_OK)) {
+            disk_order[i].position |= file.obj.sclust;
+            fvx_close(&file);
+        }
+    }
+
+    qsort(disk_order, contents->n_entries, sizeof(DiskOrderEntry), compDiskOrderEntry);
+    for (u32 i = 0; i < contents->n_entries; i++)
+        order[i] = disk_order[i].index;
+
+    free(disk_order);
+    return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "common.h"
+#include "fsdir.h"
+
+#define VERIFYIDX_NAME  "verify.idx"
+
+u32 OpenVerifyIndex(void);
+u32 CloseVerifyIndex(void);
+u32 VerifyGameFileIndexed(const char* path, bool sig_check);
+u32 GetDiskOrder(u32* order, DirStruct* contents);
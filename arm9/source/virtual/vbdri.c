@@ -3,11 +3,13 @@
 #include "disadiff.h"
 #include "vdisadiff.h"
 #include "bdri.h"
+#include "sortidx.h"
 #include "vff.h"
 #include "ui.h"
 #include "language.h"
 
 #define VBDRI_MAX_ENTRIES   8192 // Completely arbitrary
+#define VBDRI_MAX_SIGCACHE  (2 * VBDRI_MAX_ENTRIES)
 
 #define VFLAG_UNKNOWN       (1UL<<28)
 #define VFLAG_ILLEGIT       (1UL<<29)
@@ -29,6 +31,12 @@ typedef struct {
     u8  console_id[4];
 } PACKED_STRUCT TickInfoEntry;
 
+// ticket signature state, identified by the SHA-256 of the ticket
+typedef struct {
+    u8 ticket_sha256[0x20];
+    u8 sig_valid;
+} PACKED_STRUCT TickSigCacheEntry;
+
 // only for the main directory
 static const VirtualFile VTickDbFileTemplates[] = {
     { "eshop"   , 0x00000000, 0x00000000, 0xFF, VFLAG_DIR | VFLAG_ESHOP },
@@ -44,6 +52,13 @@ static TickInfoEntry* tick_info = NULL;
 static u8* cached_entry = NULL;
 static int cache_index;
 
+// kept across mounts, signatures don't change with the ticket.db they are in
+static SortedIndex sig_cache = {
+    .entry_size = sizeof(TickSigCacheEntry),
+    .key_size = 0x20,
+    .max_entries = VBDRI_MAX_SIGCACHE
+};
+
 void DeinitVBDRIDrive(void) {
     free(title_ids);
     free(tick_info);
@@ -55,6 +70,28 @@ void DeinitVBDRIDrive(void) {
     cache_index = -1;
 }
 
+static int compTicketIndexEntry(const void* e1, const void* e2) {
+    return memcmp(((const TicketIndexEntry*) e1)->title_id, ((const TicketIndexEntry*) e2)->title_id, 8);
+}
+
+// signature checks are expensive, only tickets not seen before are checked
+static u32 CheckVBDRITicketSignature(const Ticket* ticket, const u8* ticket_sha256) {
+    TickSigCacheEntry sig;
+
+    if (!sig_cache.entries) OpenSortedIndex(&sig_cache, NULL);
+    TickSigCacheEntry* known = (TickSigCacheEntry*) FindSortedIndexEntry(&sig_cache, ticket_sha256);
+    if (known) return known->sig_valid ? 0 : 1;
+
+    u32 ret = ValidateTicketSignature((Ticket*) ticket);
+
+    // nothing happens if the cache is full
+    memcpy(sig.ticket_sha256, ticket_sha256, 0x20);
+    sig.sig_valid = (ret == 0) ? 1 : 0;
+    WriteSortedIndexEntry(&sig_cache, &sig);
+
+    return ret;
+}
+
 bool SortVBDRITickets() {
     if (!CheckVBDRIDrive() || !is_tickdb)
         return false;
@@ -63,27 +100,44 @@ bool SortVBDRITickets() {
         return true;
 
     tick_info = (TickInfoEntry*) malloc(num_entries * sizeof(TickInfoEntry));
-    if (!tick_info)
+    TicketIndexEntry* index = (TicketIndexEntry*) malloc(num_entries * sizeof(TicketIndexEntry));
+    u32 n_index = 0;
+    if (!tick_info || !index) {
+        free(tick_info);
+        free(index);
+        tick_info = NULL;
         return false;
+    }
 
     ShowString("%s", STR_SORTING_TICKETS_PLEASE_WAIT);
 
-    for (u32 i = 0; i < num_entries - 1; i++) {
-        Ticket* ticket;
-        if (ReadTicketFromDB(PART_PATH, title_ids + (i * 8), &ticket) != 0) {
-            free(tick_info);
-            tick_info = NULL;
-            return false;
+    // one pass over ticket.db, signatures are checked on the way
+    if (ListTicketIndex(PART_PATH, index, num_entries, &n_index, CheckVBDRITicketSignature) != 0) {
+        free(tick_info);
+        free(index);
+        tick_info = NULL;
+        return false;
+    }
+    qsort(index, n_index, sizeof(TicketIndexEntry), compTicketIndexEntry);
+
+    for (u32 i = 0; i < num_entries; i++) {
+        const u8* title_id = title_ids + (i * 8); // also works as search key, title id comes first in index entries
+        TicketIndexEntry* entry = (getbe64(title_id) == 0) ? NULL :
+            (TicketIndexEntry*) bsearch(title_id, index, n_index, sizeof(TicketIndexEntry), compTicketIndexEntry);
+        if (!entry) { // empty or malformed ticket
+            memset(tick_info + i, 0x00, sizeof(TickInfoEntry));
+            tick_info[i].type = 3;
+            continue;
         }
         tick_info[i].type =
-            (ValidateTicketSignature(ticket) != 0) ? 3 : // illegit
-            (ticket->commonkey_idx > 1) ? 2 : // unknown
-            ticket->commonkey_idx; // eshop (0) / system (1)
-        tick_info[i].size = GetTicketSize(ticket);
-        memcpy(tick_info[i].console_id, ticket->console_id, 4);
-        free(ticket);
+            !entry->sig_valid ? 3 : // illegit
+            (entry->commonkey_idx > 1) ? 2 : // unknown
+            entry->commonkey_idx; // eshop (0) / system (1)
+        tick_info[i].size = entry->size;
+        memcpy(tick_info[i].console_id, entry->console_id, 4);
     }
 
+    free(index);
     ClearScreenF(true, false, COLOR_STD_BG);
 
     return true;
@@ -173,8 +173,7 @@ int ReadCiaContentImageBytes(void* buffer, u64 offset, u64 count, u32 cia_cnt_id
     // setup key for CIA
     u8 tik[16] __attribute__((aligned(32)));
     memcpy(tik, cia_titlekey, 16);
-    setup_aeskey(0x11, tik);
-    use_aeskey(0x11);
+    use_aeskey_transient(tik);
 
     // setup IV0
     u8 iv0[AES_BLOCK_SIZE] = { 0 };
@@ -131,8 +131,7 @@ int ReadVMemOTPDecrypted(const VirtualFile* vfile, void* buffer, u64 offset, u64
             return 1; // crypto not available
     }
 
-    setup_aeskey(0x11, otp_key);
-    use_aeskey(0x11);
+    use_aeskey_transient(otp_key);
     cbc_decrypt(otp_mem, otp_local, __OTP_LEN / 0x10, AES_CNT_TITLEKEY_DECRYPT_MODE, otp_iv);
     memcpy(buffer, otp_local + offset, count);
     return 0;